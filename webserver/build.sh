@@ -12,7 +12,7 @@ fi
 # Compile source files
 echo "Compiling source files..."
 
-SOURCES="srcs/HttpRequest.cpp srcs/HttpResponse.cpp srcs/StaticFileHandler.cpp srcs/UploadHandler.cpp tests/test_http.cpp"
+SOURCES="srcs/HttpRequest.cpp srcs/HeaderId.cpp srcs/UriPath.cpp srcs/ChunkedDecoder.cpp srcs/RequestBody.cpp srcs/HttpResponse.cpp srcs/SharedFile.cpp srcs/Arena.cpp srcs/Scan.cpp srcs/StaticFileHandler.cpp srcs/UploadHandler.cpp tests/test_http.cpp"
 CXXFLAGS="-Wall -Wextra -Werror -std=c++98 -Iincludes"
 
 # Create objs directory
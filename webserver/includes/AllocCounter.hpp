@@ -0,0 +1,12 @@
+#ifndef ALLOCCOUNTER_HPP
+#define ALLOCCOUNTER_HPP
+
+// Heap allocation counting for `make alloc-count` builds. With
+// WEBSERV_COUNT_ALLOCS defined the global operator new is replaced by one
+// that counts calls (process-wide, all threads); otherwise nothing is
+// replaced and the count is unavailable.
+
+// operator new calls so far, or -1 when not counting
+long heapAllocations();
+
+#endif // ALLOCCOUNTER_HPP
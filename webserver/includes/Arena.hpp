@@ -0,0 +1,120 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <new>
+
+#define ARENA_BLOCK_SIZE 4096   // First block of a connection's arena
+#define ARENA_RETAIN_SIZE 65536 // Most kept between requests
+#define ARENA_ALIGN 16
+
+// Bump allocator for storage that dies with the request being handled.
+// Allocation is a pointer increment; nothing is freed individually.
+// reset() drops everything at once and keeps a single block sized to
+// the last request's total (up to ARENA_RETAIN_SIZE), so a steady
+// connection allocates nothing.
+class Arena {
+private:
+    struct Block {
+        Block* next;
+        size_t size; // Usable bytes after the header
+    };
+
+    Block* blocks; // Newest first
+    char* cursor;
+    char* limit;
+    size_t used; // Bytes handed out since the last reset
+
+    static __thread Arena* active; // Per thread, see ArenaScope
+
+    Arena(const Arena&);
+    Arena& operator=(const Arena&);
+
+    void addBlock(size_t min_size);
+    void release();
+
+public:
+    Arena();
+    ~Arena();
+
+    void* allocate(size_t size) {
+        size = (size + ARENA_ALIGN - 1) & ~static_cast<size_t>(ARENA_ALIGN - 1);
+        if (static_cast<size_t>(limit - cursor) < size)
+            addBlock(size);
+        void* p = cursor;
+        cursor += size;
+        used += size;
+        return p;
+    }
+    void reset();
+
+    size_t getUsed() const { return used; }
+
+    // The arena of the request this thread is handling, or NULL
+    static Arena* current() { return active; }
+    friend class ArenaScope;
+};
+
+// Makes an arena current for a request's duration, then resets it.
+// Everything allocated from it must be gone before the scope ends.
+class ArenaScope {
+private:
+    Arena& arena;
+    Arena* previous;
+
+    ArenaScope(const ArenaScope&);
+    ArenaScope& operator=(const ArenaScope&);
+
+public:
+    explicit ArenaScope(Arena& arena);
+    ~ArenaScope();
+};
+
+// STL allocator drawing from the arena current when it was constructed,
+// or from the heap outside any ArenaScope. Containers copy it, so they
+// keep using the arena they started with.
+template <typename T>
+class ArenaAllocator {
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind { typedef ArenaAllocator<U> other; };
+
+    Arena* arena;
+
+    ArenaAllocator() throw() : arena(Arena::current()) {}
+    ArenaAllocator(const ArenaAllocator& other) throw() : arena(other.arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) throw() : arena(other.arena) {}
+
+    pointer allocate(size_type n, const void* = 0) {
+        if (arena)
+            return static_cast<pointer>(arena->allocate(n * sizeof(T)));
+        return static_cast<pointer>(::operator new(n * sizeof(T)));
+    }
+    void deallocate(pointer p, size_type) {
+        if (!arena)
+            ::operator delete(p);
+    }
+
+    void construct(pointer p, const T& value) { new (static_cast<void*>(p)) T(value); }
+    void destroy(pointer p) { p->~T(); }
+    pointer address(reference r) const { return &r; }
+    const_pointer address(const_reference r) const { return &r; }
+    size_type max_size() const throw() { return static_cast<size_type>(-1) / sizeof(T); }
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena == b.arena; }
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena != b.arena; }
+
+#endif // ARENA_HPP
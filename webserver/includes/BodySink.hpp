@@ -0,0 +1,14 @@
+#ifndef BODYSINK_HPP
+#define BODYSINK_HPP
+
+#include <cstddef>
+
+// Consumer of decoded request body bytes
+class BodySink {
+public:
+    virtual ~BodySink() {}
+    // false if the data could not be stored
+    virtual bool write(const char* data, size_t length) = 0;
+};
+
+#endif
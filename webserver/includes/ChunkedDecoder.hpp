@@ -0,0 +1,56 @@
+#ifndef CHUNKEDDECODER_HPP
+#define CHUNKEDDECODER_HPP
+
+#include "BodySink.hpp"
+#include <cstddef>
+
+#define MAX_CHUNK_EXTENSION 4096 // Bytes of ";name=value" allowed per size line
+#define MAX_TRAILER_SIZE 8192
+
+// Incremental decoder for "Transfer-Encoding: chunked" bodies. Input can
+// be split anywhere; chunk payload goes straight to the sink, so nothing
+// is buffered here. Trailer fields are checked for size and dropped.
+class ChunkedDecoder {
+private:
+    enum State {
+        CHUNK_SIZE,
+        CHUNK_EXTENSION,
+        CHUNK_SIZE_LF,
+        CHUNK_DATA,
+        CHUNK_DATA_CR,
+        CHUNK_DATA_LF,
+        TRAILER_START,
+        TRAILER_LINE,
+        FINAL_LF,
+        DONE,
+        FAILED
+    };
+
+    State state;
+    size_t chunk_size; // Size being read, then bytes of it still to come
+    size_t size_digits;
+    size_t extension_bytes;
+    size_t trailer_bytes;
+    size_t decoded; // Payload bytes passed to the sink
+    size_t max_size;
+    int error_code;
+
+    size_t fail(int code);
+    bool endSizeLine();
+
+public:
+    ChunkedDecoder();
+
+    void reset(size_t max_body_size);
+
+    // Decode from data, returning how many bytes were consumed. Stops just
+    // after the final CRLF so bytes of a pipelined request are left alone.
+    size_t feed(const char* data, size_t length, BodySink& sink);
+
+    bool isDone() const { return state == DONE; }
+    bool hasFailed() const { return state == FAILED; }
+    int getErrorCode() const { return error_code; }
+    size_t getDecodedSize() const { return decoded; }
+};
+
+#endif
@@ -2,31 +2,75 @@
 #define CLIENT_HPP
 
 #include "HttpRequest.hpp"
+#include "TimerWheel.hpp"
+#include "OutputQueue.hpp"
+#include "Arena.hpp"
 #include <string>
-#include <ctime>
+
+// Operations a completion-based reactor is running for a client
+#define IO_RECV   0x01 // Multishot recv armed
+#define IO_CANCEL 0x02 // Its cancellation has been requested
+#define IO_SEND   0x04
+#define IO_READ   0x08 // File chunk being read into the chunk buffer
+#define IO_FLUSH  0x10 // Output to start before the next wait
+#define IO_POLL   0x20 // Waiting for the socket to be writable, to sendfile
+#define IO_INFLIGHT (IO_RECV | IO_SEND | IO_READ)
 
 class Client {
 private:
 	int _fd;
+	size_t _endpoint; // Index of the listen endpoint it connected through
 	HttpRequest _request;
-	time_t _last_activity;
+	size_t _request_count; // Requests answered on this connection
+	TimerNode _timer; // Current timeout (header, body, keep-alive or send)
+	OutputQueue _output; // Pending response bytes
+	Arena _arena; // Transient storage of the request being handled
+	bool _closing; // Close once the output queue drains, read nothing more
+	bool _paused; // Output above the high watermark, reading suspended
+	bool _lingering; // Rejected mid-request: discard input until EOF, then close
+	int _events; // Interest currently registered with the reactor
+	int _io; // IO_* operations in progress (completion-based reactor)
+	std::string _chunk; // File bytes being read for the output queue (IO_READ)
+	unsigned long _request_start; // When the current request began arriving (ms)
+	unsigned long _rate_mark; // Start of the current body rate window (ms)
+	size_t _rate_mark_bytes; // Body bytes received at _rate_mark
+
+	Client(const Client&);
+	Client& operator=(const Client&);
 
 public:
 	Client();
-	Client(int fd);
+	Client(int fd, size_t endpoint = 0);
 	~Client();
 
 	// Getters
 	int getFd() const;
+	size_t getEndpoint() const;
 	HttpRequest& getRequest();
 	const HttpRequest& getRequest() const;
-	time_t getLastActivity() const;
-
-	// Activity tracking
-	void updateActivity();
+	size_t getRequestCount() const;
+	TimerNode& getTimer();
+	OutputQueue& getOutput();
+	Arena& getArena();
+	bool isClosing() const;
+	void setClosing();
+	bool isPaused() const;
+	void setPaused(bool paused);
+	bool isLingering() const;
+	void setLingering();
+	int getEvents() const;
+	void setEvents(int events);
+	int getIo() const;
+	void setIo(int io);
+	std::string& getChunk();
+	unsigned long getRequestStart() const;
+	void setRequestStart(unsigned long now_ms);
+	unsigned long getRateMark() const;
+	size_t getRateMarkBytes() const;
+	void markBodyRate(unsigned long now_ms, size_t body_bytes);
 
 	// Request management
-	void resetRequest();
+	void resetRequest(); // Starts the next request from any pipelined leftover
 };
 
 #endif // CLIENT_HPP
@@ -4,6 +4,18 @@
 #include <string>
 #include <vector>
 #include <map>
+#include "VirtualHostTable.hpp"
+
+#define MAX_WORKER_THREADS 256
+#define MAX_WORKER_PROCESSES 256
+#define DEFAULT_LISTEN_BACKLOG 511
+#define DEFAULT_ACCEPT_BATCH 64
+#define DEFAULT_KEEPALIVE_REQUESTS 1000
+#define DEFAULT_CLIENT_BODY_BUFFER_SIZE 16384 // Larger request bodies go to a temp file
+#define DEFAULT_OUTPUT_HIGH_WATERMARK 1048576 // Stop reading a client above this many queued bytes
+#define DEFAULT_OUTPUT_LOW_WATERMARK 262144   // Resume once its queue drains to this
+#define DEFAULT_FILE_CACHE_SIZE 8388608       // Static file cache per worker, 0 disables it
+#define DEFAULT_FILE_CACHE_MAX_FILE 131072    // Larger files are always sent from disk
 
 struct LocationConfig {
 	std::string path;
@@ -11,22 +23,55 @@ struct LocationConfig {
 	std::vector<std::string> methods;
 	std::string index;
 	bool autoindex;
+	bool stub_status; // Serve worker counters instead of files
 	std::string redirect;
 	std::string upload_path;
 	std::map<std::string, std::string> cgi_extensions; // .php -> /usr/bin/php-cgi
+	size_t max_body_size; // Overrides the server's when has_max_body_size
+	bool has_max_body_size;
 
-	LocationConfig() : autoindex(false) {}
+	LocationConfig()
+		: autoindex(false), stub_status(false), max_body_size(0), has_max_body_size(false) {}
 };
 
 struct ServerConfig {
 	int port;
 	std::string host;
-	std::string server_name;
+	std::string server_name; // First of server_names
+	std::vector<std::string> server_names;
 	size_t max_body_size;
-	std::map<int, std::string> error_pages;
+	size_t client_body_buffer_size;
+	std::map<int, std::string> error_pages; // As configured: code -> path
+	std::map<int, std::string> error_page_bodies; // Their contents, read by Config::parse()
 	std::vector<LocationConfig> locations;
 
-	ServerConfig() : port(8080), host("0.0.0.0"), max_body_size(1048576) {} // 1MB default
+	ServerConfig()
+		: port(8080), host("0.0.0.0"), max_body_size(1048576), // 1MB default
+		  client_body_buffer_size(DEFAULT_CLIENT_BODY_BUFFER_SIZE) {}
+};
+
+// Connection timeouts in milliseconds (configured in seconds)
+struct Timeouts {
+	unsigned long header;    // client_header_timeout: between reads of the request head
+	unsigned long body;      // client_body_timeout: between reads of the body
+	unsigned long keepalive; // keepalive_timeout: idle between requests
+	unsigned long send;      // send_timeout: between writes of the response
+	unsigned long header_deadline;  // client_header_deadline: whole request head, 0 = off
+	unsigned long body_rate_window; // client_body_rate_window: span body_min_rate is averaged over
+	size_t body_min_rate;           // client_body_min_rate: bytes/s, 0 = off
+
+	Timeouts()
+		: header(60000), body(60000), keepalive(60000), send(60000),
+		  header_deadline(30000), body_rate_window(10000), body_min_rate(1024) {}
+};
+
+// A distinct host:port pair to listen on, shared by one or more server blocks
+struct ListenEndpoint {
+	std::string host;
+	int port;
+	size_t default_server; // First server block declared for this pair
+
+	ListenEndpoint() : port(0), default_server(0) {}
 };
 
 class Config {
@@ -34,6 +79,23 @@ private:
 	std::vector<ServerConfig> _servers;
 	std::string _config_file;
 
+	// Virtual hosting, built once after parsing
+	std::vector<ListenEndpoint> _endpoints;
+	VirtualHostTable _vhosts;
+
+	// Global (top-level) directives
+	std::string _event_backend;
+	int _worker_threads;
+	int _worker_processes;
+	Timeouts _timeouts;
+	int _listen_backlog;
+	int _accept_batch;
+	int _keepalive_requests;
+	size_t _output_high_watermark;
+	size_t _output_low_watermark;
+	size_t _file_cache_size;
+	size_t _file_cache_max_file;
+
 public:
 	Config();
 	Config(const std::string& config_file);
@@ -45,17 +107,37 @@ public:
 	// Getters
 	const std::vector<ServerConfig>& getServers() const;
 	const ServerConfig& getServerConfig(size_t index) const;
+	const std::vector<ListenEndpoint>& getEndpoints() const;
+	const std::string& getEventBackend() const;
+	int getWorkerThreads() const;
+	int getWorkerProcesses() const;
+	const Timeouts& getTimeouts() const;
+	int getListenBacklog() const;
+	int getAcceptBatch() const;
+	int getKeepaliveRequests() const;
+	size_t getOutputHighWatermark() const;
+	size_t getOutputLowWatermark() const;
+	size_t getFileCacheSize() const;
+	size_t getFileCacheMaxFile() const;
 
 	// Matching
+	const ServerConfig& resolveServer(size_t endpoint, const std::string& host_header) const;
+	const ServerConfig& resolveServer(size_t endpoint, const char* host_header, size_t length) const;
 	const LocationConfig* findLocation(const std::string& uri, const ServerConfig& server) const;
 
 private:
 	void _parseServerBlock(const std::string& block, ServerConfig& config);
 	void _parseLocationBlock(const std::string& block, LocationConfig& location);
 	void _parseConfigFile(const std::string& path);
+	void _parseGlobalDirective(const std::string& directive);
+	void _buildVirtualHosts();
+	void _loadErrorPages();
 	size_t _findClosingBrace(const std::string& str, size_t start) const;
 	std::string _trim(const std::string& str) const;
 	std::vector<std::string> _split(const std::string& str, char delimiter) const;
+	std::vector<std::string> _tokenize(const std::string& str) const;
+	unsigned long _parseSeconds(const std::string& value) const;
+	size_t _parseSize(const std::string& value) const;
 };
 
 #endif // CONFIG_HPP
@@ -0,0 +1,32 @@
+#ifndef EPOLLREACTOR_HPP
+#define EPOLLREACTOR_HPP
+
+#include "Reactor.hpp"
+#include <vector>
+
+#ifdef __linux__
+# include <sys/epoll.h>
+
+// epoll(7) backend, level-triggered so it behaves exactly like poll(2)
+class EpollReactor : public Reactor {
+private:
+	int _epoll_fd;
+	std::vector<struct epoll_event> _ready;
+
+	EpollReactor(const EpollReactor&);
+	EpollReactor& operator=(const EpollReactor&);
+
+public:
+	EpollReactor();
+	virtual ~EpollReactor();
+
+	virtual bool add(int fd, int events);
+	virtual bool modify(int fd, int events);
+	virtual void remove(int fd);
+	virtual int wait(std::vector<ReactorEvent>& events, int timeout_ms);
+	virtual const char* name() const { return "epoll"; }
+};
+
+#endif // __linux__
+
+#endif // EPOLLREACTOR_HPP
@@ -0,0 +1,33 @@
+#ifndef ERRORPAGES_HPP
+#define ERRORPAGES_HPP
+
+#include <vector>
+#include "OutputQueue.hpp"
+
+class Config;
+
+// A worker's configured error pages, each built once into a response head
+// (status line to Content-Length) and a body. Serving one queues shared
+// references to both: no file access, no copy. The buffers' reference
+// counts aren't atomic, so every worker builds its own table.
+struct ErrorPage {
+	int code;
+	SharedBuffer head; // Without Date, Connection and the blank line
+	SharedBuffer body;
+};
+
+class ErrorPages {
+private:
+	std::vector<std::vector<ErrorPage> > _servers; // Indexed like Config::getServers()
+
+	ErrorPages(const ErrorPages&);
+	ErrorPages& operator=(const ErrorPages&);
+
+public:
+	explicit ErrorPages(const Config& config);
+
+	// NULL when the server block has no page for code
+	const ErrorPage* find(size_t server, int code) const;
+};
+
+#endif // ERRORPAGES_HPP
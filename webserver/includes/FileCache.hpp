@@ -0,0 +1,81 @@
+#ifndef FILECACHE_HPP
+#define FILECACHE_HPP
+
+#include <string>
+#include <list>
+#include <map>
+#include "OutputQueue.hpp"
+
+#define FILE_CACHE_ENTRY_OVERHEAD 256 // Bookkeeping charged per entry on top of its bytes
+
+class HttpResponse;
+
+// A small static file as it is served: the response head (status line
+// through Last-Modified, without Date, Connection and the blank line)
+// and the body, both ready to queue
+struct CachedFile {
+	std::string key;  // Location root + request path
+	std::string path; // File the body was read from
+	std::string etag;
+	SharedBuffer head;
+	SharedBuffer body;
+	size_t bytes; // Charged against the capacity
+};
+
+// Per-worker cache of hot small files, bounded in bytes and evicting the
+// least recently used. The directories from the location root down to
+// each cached file are watched with inotify; any change to the file or
+// to one of them drops its entries, so a hit never needs a syscall. The worker polls the inotify
+// descriptor with its other events. Per worker because the buffers'
+// reference counts aren't atomic.
+class FileCache {
+private:
+	typedef std::list<CachedFile> EntryList; // Most recently used first
+
+	EntryList _entries;
+	std::map<std::string, EntryList::iterator> _index; // By key
+	std::map<int, std::string> _watches; // inotify watch -> directory
+	std::map<std::string, int> _watched; // directory -> inotify watch
+	int _notify_fd;
+	size_t _capacity;
+	size_t _max_file;
+	size_t _bytes;
+	unsigned long _hits;
+	unsigned long _misses;
+	unsigned long _evictions;
+	unsigned long _invalidations;
+
+	FileCache(const FileCache&);
+	FileCache& operator=(const FileCache&);
+
+	bool _watch(const std::string& directory);
+	void _invalidate(const std::string& path);
+	void _erase(EntryList::iterator entry);
+
+public:
+	FileCache(size_t capacity, size_t max_file);
+	~FileCache();
+
+	bool enabled() const { return _notify_fd >= 0; }
+	int getNotifyFd() const { return _notify_fd; }
+
+	// The entry for uri under root, now the most recently used, or NULL
+	const CachedFile* find(const std::string& root, const std::string& uri);
+	// Keep the file behind a 200 response for uri, if it is small enough
+	// and is still the file at root + uri (or its index_file, for a
+	// directory)
+	void insert(const std::string& root, const std::string& uri, const std::string& index_file,
+	            const HttpResponse& response);
+	// Drop whatever the pending inotify events say has changed
+	void processEvents();
+
+	size_t getBytes() const { return _bytes; }
+	size_t getCapacity() const { return _capacity; }
+	size_t getCount() const { return _index.size(); }
+	unsigned long getHits() const { return _hits; }
+	unsigned long getMisses() const { return _misses; }
+	unsigned long getEvictions() const { return _evictions; }
+	unsigned long getInvalidations() const { return _invalidations; }
+};
+
+#endif // FILECACHE_HPP
@@ -0,0 +1,40 @@
+#ifndef HEADERID_HPP
+#define HEADERID_HPP
+
+#include <cstddef>
+
+// Headers the server looks at, interned to small integers so a request
+// can keep them in a fixed array and read them in O(1)
+enum HeaderId {
+    HEADER_HOST,
+    HEADER_CONTENT_LENGTH,
+    HEADER_CONTENT_TYPE,
+    HEADER_TRANSFER_ENCODING,
+    HEADER_CONNECTION,
+    HEADER_RANGE,
+    HEADER_IF_RANGE,
+    HEADER_IF_NONE_MATCH,
+    HEADER_IF_MODIFIED_SINCE,
+    HEADER_ACCEPT_ENCODING,
+    HEADER_EXPECT,
+    HEADER_COOKIE,
+    HEADER_USER_AGENT,
+    HEADER_ACCEPT,
+    HEADER_AUTHORIZATION,
+    HEADER_REFERER,
+    HEADER_ACCEPT_LANGUAGE,
+    HEADER_UPGRADE,
+    HEADER_COUNT,
+    HEADER_UNKNOWN = HEADER_COUNT
+};
+
+// Case-insensitive name -> id, HEADER_UNKNOWN for anything else
+HeaderId lookupHeaderId(const char* name, size_t length);
+
+// Lowercase canonical name of a known header
+const char* headerName(HeaderId id);
+
+// ASCII case-insensitive comparison, no allocation
+bool equalsIgnoreCase(const char* a, size_t a_len, const char* b, size_t b_len);
+
+#endif
@@ -1,8 +1,10 @@
 #ifndef HTTPREQUEST_HPP
 #define HTTPREQUEST_HPP
 
+#include "ChunkedDecoder.hpp"
+#include "HeaderId.hpp"
+#include "RequestBody.hpp"
 #include <string>
-#include <map>
 #include <vector>
 
 enum HttpMethod {
@@ -22,31 +24,54 @@ enum ParseState {
     ERROR
 };
 
+#define MAX_HEADER_SIZE 8192 // Request line + headers
+#define RETAIN_BUFFER_SIZE 65536 // Larger buffers are freed between requests
+
+// One header as offsets into the receive buffer, so nothing is copied
+struct HeaderField {
+    size_t name;
+    size_t name_length;
+    size_t value;
+    size_t value_length;
+};
+
 class HttpRequest {
 private:
     HttpMethod method;
-    std::string uri;
+    std::string uri; // Decoded and normalized path, never above "/"
     std::string query_string;
     std::string http_version;
-    std::map<std::string, std::string> headers;
-    std::string body;
+    HeaderField known_headers[HEADER_COUNT]; // By HeaderId, name_length 0 if absent
+    std::vector<HeaderField> other_headers; // Everything else, in arrival order
+    RequestBody body;
     ParseState state;
-    std::string raw_data;
-    size_t bytes_parsed;
+    std::string raw_data; // Receive buffer, kept across pipelined requests
+    size_t bytes_parsed; // Start of the first unparsed line (or the body)
+    size_t scan_offset; // Where the next search for a line end resumes
     size_t content_length;
+    bool chunked;
+    ChunkedDecoder decoder;
+    size_t body_received; // Body bytes already handed to the body
+    size_t max_body_size;
+    bool body_limit_set;
+    bool defer_body; // Stop after the headers until setBodyLimit()
+    bool expect_continue; // Client waits for "100 Continue" before the body
     std::string boundary; // For multipart/form-data
     int error_code;
 
-    void parseRequestLine(const std::string& line);
-    void parseHeader(const std::string& line);
-    HttpMethod stringToMethod(const std::string& method_str);
-    void parseQueryString();
-    bool isChunked() const;
+    bool parseBuffered();
+    void parseRequestLine(size_t start, size_t length);
+    void parseHeader(size_t start, size_t length);
+    void finishHeaders();
+    bool parseBody();
+    void fail(int code);
+    void clearParsed();
 
 public:
     HttpRequest();
     
-    // Main parsing method - returns true if request is complete
+    // Main parsing method - returns true if request is complete. Bytes
+    // arriving after a complete request are kept for the next one.
     bool parse(const char* data, size_t len);
     
     // Getters
@@ -55,13 +80,32 @@ public:
     const std::string& getUri() const { return uri; }
     const std::string& getQueryString() const { return query_string; }
     const std::string& getHttpVersion() const { return http_version; }
-    const std::map<std::string, std::string>& getHeaders() const { return headers; }
     std::string getHeader(const std::string& key) const;
-    const std::string& getBody() const { return body; }
+    // Allocation-free lookups; value points into the receive buffer.
+    // Known headers are O(1) by id, other names scan a short list.
+    bool findHeader(HeaderId id, const char*& value, size_t& length) const;
+    bool findHeader(const char* name, const char*& value, size_t& length) const;
+    bool headerContains(HeaderId id, const char* token) const;
+    bool headerContains(const char* name, const char* token) const;
+    size_t getHeaderCount() const;
+    const RequestBody& getBody() const { return body; }
     ParseState getState() const { return state; }
     int getErrorCode() const { return error_code; }
     size_t getContentLength() const { return content_length; }
     const std::string& getBoundary() const { return boundary; }
+    size_t getBytesReceived() const { return raw_data.size(); }
+    size_t getBodyReceived() const { return body_received; }
+    bool keepAlive() const;
+    
+    // Body size limit. With requireBodyLimit(), parsing stops once the
+    // headers are in until the caller (who can now pick the server block)
+    // calls setBodyLimit(); a body over the limit fails with 413. Bodies
+    // larger than buffer_size are spooled to a temporary file.
+    void requireBodyLimit() { defer_body = true; }
+    bool needsBodyLimit() const { return state == BODY && defer_body && !body_limit_set; }
+    void setBodyLimit(size_t limit, size_t buffer_size = static_cast<size_t>(-1));
+    // True while an accepted body is held back by "Expect: 100-continue"
+    bool expectsContinue() const { return expect_continue && state == BODY; }
     
     // Validation
     bool isValid() const { return state != ERROR; }
@@ -69,6 +113,9 @@ public:
     
     // Reset for reuse
     void reset();
+    // Move on to the next pipelined request: bytes after this one are kept
+    // (and parsed), buffers keep their capacity
+    void startNext();
 };
 
 #endif
@@ -1,19 +1,52 @@
 #ifndef HTTPRESPONSE_HPP
 #define HTTPRESPONSE_HPP
 
+#include "Arena.hpp"
+#include "SharedFile.hpp"
 #include <string>
-#include <map>
+#include <vector>
+#include <ctime>
 
+// Strings and containers that live in the current request's arena
+typedef std::basic_string<char, std::char_traits<char>, ArenaAllocator<char> > ArenaString;
+
+struct HeaderLine {
+    ArenaString name;
+    ArenaString value;
+};
+typedef std::vector<HeaderLine, ArenaAllocator<HeaderLine> > ArenaHeaderList;
+
+// Complete status line ("HTTP/1.1 404 Not Found\r\n"), built at compile time
+struct StatusLine {
+    int code;
+    const char* text;
+    const char* line;
+    size_t length;
+};
+
+#define RESPONSE_HEADERS_RESERVE 8 // Header slots reserved up front
+
+// Error responses carry a short built-in page; configured error_page
+// files are substituted by the worker (see ErrorPages).
+// Header storage comes from the request's arena when built inside an
+// ArenaScope (as the worker does), from the heap otherwise. Headers are
+// sent in the order they were first set. The body is a plain string or an
+// open file, kept apart from the head: it outlives the request in the
+// output queue, and a file is sent from there with sendfile().
 class HttpResponse {
 private:
     int status_code;
-    std::string status_message;
-    std::map<std::string, std::string> headers;
+    const StatusLine* status; // NULL for codes missing from the table
+    ArenaHeaderList headers;
     std::string body;
+    SharedFile file; // The body instead, when valid
+    size_t file_length;
     bool headers_sent;
     
-    std::string getStatusMessage(int code) const;
-    static std::string loadErrorPage(const std::string& error_code);
+    void setContentLength(size_t length);
+    void setHeader(const char* key, size_t key_length, const char* value, size_t value_length);
+    static const StatusLine* findStatus(int code);
+    static const char* getStatusMessage(int code);
     
 public:
     HttpResponse();
@@ -23,14 +56,36 @@ public:
     void setStatusCode(int code);
     void setHeader(const std::string& key, const std::string& value);
     void setBody(const std::string& content);
+    // Take the contents as the body without copying, leaves content empty
+    void adoptBody(std::string& content);
+    // The first length bytes of file as the body, never read into memory
+    void setFileBody(const SharedFile& file, size_t length);
     void setContentType(const std::string& mime_type);
     
     // Getters
     int getStatusCode() const { return status_code; }
+    std::string getHeader(const std::string& key) const; // "" when not set
     const std::string& getBody() const { return body; }
+    bool hasFileBody() const { return file.valid(); }
+    const SharedFile& getFile() const { return file; }
+    size_t getFileLength() const { return file_length; }
     
-    // Build the complete HTTP response
+    // Build the complete HTTP response (reads a file body into it)
     std::string build();
+    // Status line and headers only, ending with the blank line; sized
+    // exactly before anything is written, so it allocates once
+    std::string buildHead() const;
+    // Move the body out (for queueing without a copy)
+    void takeBody(std::string& out);
+    
+    // Header values: IMF-fixdate ("Sun, 06 Nov 1994 08:49:37 GMT") and a
+    // validator from a file's mtime and size ("65a1f3c2-800", quoted)
+    static std::string httpDate(time_t when);
+    static std::string entityTag(time_t mtime, size_t size);
+    
+    // An If-None-Match value ("*" or a list of entity tags) names this tag,
+    // compared weakly: a W/ prefix on either side is ignored
+    static bool matchesEntityTag(const char* list, size_t length, const std::string& etag);
     
     // Common response builders
     static HttpResponse ok(const std::string& content, const std::string& content_type = "text/html");
@@ -43,6 +98,7 @@ public:
     static HttpResponse internalServerError(const std::string& message = "Internal Server Error");
     static HttpResponse notImplemented(const std::string& message = "Not Implemented");
     static HttpResponse payloadTooLarge(const std::string& message = "Payload Too Large");
+    static HttpResponse error(int code); // Any status, generic HTML body
 };
 
 #endif
@@ -0,0 +1,89 @@
+#ifndef OUTPUTQUEUE_HPP
+#define OUTPUTQUEUE_HPP
+
+#include <string>
+#include <deque>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include "SharedFile.hpp"
+
+#define OUTPUT_IOV_MAX 64 // Segments handed to a single writev()
+
+// Immutable, reference-counted byte block. Copies share the same storage,
+// so one response body can sit in several queues without being copied.
+// The count is not atomic: buffers never leave the worker that made them.
+class SharedBuffer {
+private:
+	struct Block {
+		size_t refs;
+		std::string data;
+	};
+	Block* _block;
+
+	void _release();
+
+public:
+	SharedBuffer();
+	explicit SharedBuffer(std::string& data); // Takes the contents, leaves data empty
+	SharedBuffer(const SharedBuffer& other);
+	SharedBuffer& operator=(const SharedBuffer& other);
+	~SharedBuffer();
+
+	const char* data() const;
+	size_t size() const;
+};
+
+// Slice of a shared buffer, or region of a file when file is valid,
+// still waiting to be written
+struct OutputSegment {
+	SharedBuffer buffer;
+	SharedFile file;
+	size_t offset;
+	size_t length;
+};
+
+// Per-connection queue of pending response bytes. Flushing gathers the
+// memory segments into one writev() and hands file regions to
+// sendfile(), so file contents never pass through userspace; a partial
+// write only advances the front segment's offset, nothing is moved or
+// copied. Memory just before a file region is sent with MSG_MORE, so a
+// small response still leaves in one packet.
+class OutputQueue {
+private:
+	std::deque<OutputSegment> _segments;
+	size_t _pending; // Bytes not yet written
+
+	bool _advance(size_t written);
+
+	OutputQueue(const OutputQueue&);
+	OutputQueue& operator=(const OutputQueue&);
+
+public:
+	OutputQueue();
+
+	void push(std::string& data); // Takes the contents, leaves data empty
+	void push(const SharedBuffer& buffer, size_t offset, size_t length);
+	void push(const SharedFile& file, off_t offset, size_t length);
+	void clear();
+
+	// Write as much as the socket accepts. Returns bytes written, or -1
+	// with errno set (EAGAIN when the socket is full, EIO when a file
+	// ended before its region did).
+	ssize_t flush(int fd);
+
+	// The same in steps, for a reactor that does the writing: the memory
+	// segments up to the first file region (file_follows tells if there is
+	// one), then dropping what was written
+	int gather(struct iovec* iov, int max, bool& file_follows) const;
+	void consume(size_t written);
+
+	// First file region still queued, and how many memory bytes precede it
+	const OutputSegment* firstFile(size_t& before) const;
+	// Turns the start of the first file region into the bytes read from it
+	void fillFile(std::string& data); // Takes the contents, leaves data empty
+
+	bool empty() const { return _pending == 0; }
+	size_t size() const { return _pending; }
+};
+
+#endif // OUTPUTQUEUE_HPP
@@ -0,0 +1,26 @@
+#ifndef POLLREACTOR_HPP
+#define POLLREACTOR_HPP
+
+#include "Reactor.hpp"
+#include <vector>
+#include <poll.h>
+
+// poll(2) backend. The pollfd array stays dense (removal swaps with the
+// last entry) and _index maps fd -> slot so no operation scans the array.
+class PollReactor : public Reactor {
+private:
+	std::vector<struct pollfd> _fds;
+	std::vector<int> _index; // fd -> position in _fds, -1 if absent
+
+public:
+	PollReactor();
+	virtual ~PollReactor();
+
+	virtual bool add(int fd, int events);
+	virtual bool modify(int fd, int events);
+	virtual void remove(int fd);
+	virtual int wait(std::vector<ReactorEvent>& events, int timeout_ms);
+	virtual const char* name() const { return "poll"; }
+};
+
+#endif // POLLREACTOR_HPP
@@ -0,0 +1,77 @@
+#ifndef REACTOR_HPP
+#define REACTOR_HPP
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+// Readiness flags shared by every backend
+#define EVENT_READ  0x1
+#define EVENT_WRITE 0x2
+#define EVENT_ERROR 0x4
+
+// What a reactor event reports
+enum ReactorOp {
+	OP_READY,  // An added fd is ready (events)
+	OP_ACCEPT, // result: the accepted fd
+	OP_RECV,   // result: bytes at data, 0 at end of stream
+	OP_SEND,   // result: bytes written
+	OP_READ    // result: file bytes read into the caller's buffer
+};
+
+struct ReactorEvent {
+	int fd;
+	int events;
+	int op;
+	int result;       // Finished operations: as above, or -errno
+	bool more;        // Multishot operation still armed after this one
+	const char* data; // OP_RECV: valid until the next wait()
+
+	ReactorEvent() : fd(-1), events(0), op(OP_READY), result(0), more(false), data(NULL) {}
+};
+
+// Event loop backend: poll(2), epoll(7), io_uring(7)
+// Registration calls are O(1) per fd; wait() fills `events` with ready fds only.
+//
+// A backend that completesIo() can also perform the socket and file I/O
+// itself: operations are queued, all go to the kernel with the next wait(),
+// and each reports back as one event carrying its op and result (one per
+// connection or datagram for the multishot ones). The fd an operation was
+// queued for is kept open until its last event has arrived.
+class Reactor {
+public:
+	virtual ~Reactor() {}
+
+	virtual bool add(int fd, int events) = 0;
+	virtual bool modify(int fd, int events) = 0;
+	virtual void remove(int fd) = 0;
+
+	// Returns the number of ready fds, -1 on error (errno set)
+	virtual int wait(std::vector<ReactorEvent>& events, int timeout_ms) = 0;
+
+	virtual const char* name() const = 0;
+
+	// Completion-based I/O, for backends that completesIo()
+	virtual bool completesIo() const { return false; }
+	virtual bool acceptMultishot(int listen_fd) { (void)listen_fd; return false; }
+	virtual bool recvMultishot(int fd) { (void)fd; return false; }
+	// iov is copied; the memory it points to must stay put until OP_SEND
+	virtual bool send(int fd, const struct iovec* iov, int count, bool more) {
+		(void)fd; (void)iov; (void)count; (void)more;
+		return false;
+	}
+	// Reads file_fd into buffer; the event carries fd, not file_fd
+	virtual bool readFile(int fd, int file_fd, off_t offset, char* buffer, size_t length) {
+		(void)fd; (void)file_fd; (void)offset; (void)buffer; (void)length;
+		return false;
+	}
+	virtual void cancelRecv(int fd) { (void)fd; }
+	virtual void cancel(int fd) { (void)fd; } // Every operation on fd
+
+	// Factory: "poll", "epoll", "io_uring" or "auto" (best readiness backend)
+	static Reactor* create(const std::string& backend);
+	static bool isSupported(const std::string& backend);
+};
+
+#endif // REACTOR_HPP
@@ -0,0 +1,53 @@
+#ifndef REQUESTBODY_HPP
+#define REQUESTBODY_HPP
+
+#include "BodySink.hpp"
+#include <string>
+#include <sys/types.h>
+
+#define BODY_TEMP_DIR "/tmp"
+#define BODY_COPY_CHUNK 65536
+
+// Request body storage. Bytes stay in memory up to the buffer size; past
+// that, everything is moved to an unlinked temporary file and further
+// writes go straight to it, so memory use per request stays bounded.
+// Handlers read through data() (mmap'd on first use for spooled bodies),
+// read() at an offset, or copyTo() another file descriptor.
+class RequestBody : public BodySink {
+private:
+    std::string memory;
+    size_t buffer_size; // Spool to disk past this many bytes
+    size_t length;
+    int fd; // Temp file, -1 while in memory
+    mutable void* mapping;
+
+    bool spool();
+
+    RequestBody(const RequestBody&);
+    RequestBody& operator=(const RequestBody&);
+
+public:
+    RequestBody();
+    ~RequestBody();
+
+    void setBufferSize(size_t size) { buffer_size = size; }
+    bool write(const char* data, size_t size);
+    void reset(); // Empty, back in memory
+
+    size_t size() const { return length; }
+    bool empty() const { return length == 0; }
+    bool isSpooled() const { return fd >= 0; }
+
+    // Whole body as one contiguous range, NULL if it can't be mapped
+    const char* data() const;
+    // Done reading this range through data(): drop its mapped pages
+    void release(size_t offset, size_t size) const;
+    // Up to size bytes at offset, like pread(); -1 on error
+    ssize_t read(size_t offset, char* buffer, size_t size) const;
+    // Write [offset, offset + size) to out_fd; false on error
+    bool copyTo(int out_fd, size_t offset, size_t size) const;
+    // Copy of the whole body (small bodies, tests)
+    std::string str() const;
+};
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef SCAN_HPP
+#define SCAN_HPP
+
+#include <cstddef>
+
+// Byte scanning kernels for the HTTP parser and multipart decoder.
+// On x86 an SSE2 or AVX2 implementation is picked once at startup from
+// what the CPU supports; everything else uses the scalar loops.
+// Like memchr, the functions return NULL when nothing is found.
+
+// First occurrence of c in [begin, end)
+const char* scanChar(const char* begin, const char* end, char c);
+
+// First occurrence of needle in [begin, end)
+const char* scanSubstring(const char* begin, const char* end, const char* needle, size_t needle_len);
+
+// Kernel in use: "scalar", "sse2" or "avx2"
+const char* scanKernel();
+
+// Force a kernel (benchmarks); false if the CPU can't run it
+bool scanSetKernel(const char* name);
+
+#endif // SCAN_HPP
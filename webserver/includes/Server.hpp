@@ -3,63 +3,65 @@
 
 #include <string>
 #include <vector>
-#include <map>
-#include <sys/poll.h>
+#include <ctime>
+#include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <fcntl.h>
 
-#define LISTEN_CONN 128
-#define BUFFER_SIZE 8192
+#define RESPAWN_DELAY 1 // Seconds to wait before restarting a worker that died right away
 
-class Client;
 class Config;
-class HttpRequest;
-class HttpResponse;
+class Worker;
+struct ListenEndpoint;
 
+// Owns the configuration and the workers. Every worker listens on each
+// distinct host:port of the config, in Config::getEndpoints() order.
+//
+// Thread mode (default): with worker_threads N, each worker gets its own
+// SO_REUSEPORT listening socket and runs on its own thread; the kernel
+// spreads incoming connections across them.
+//
+// Process mode (worker_processes N): this process becomes a master that
+// binds the listening sockets once, forks N worker processes sharing them
+// and restarts any that die. Each child runs worker_threads event loops.
 class Server {
 private:
 	Config* _config;
-	int _server_fd;
-	std::vector<struct pollfd> _poll_fds;
-	std::map<int, Client*> _clients; // fd -> Client*
-	std::map<int, std::string> _output_buffers; // Output buffers per client fd
+	std::vector<Worker*> _workers;
+
+	// Process mode (master only)
+	std::vector<int> _listen_fds;
+	std::vector<pid_t> _children;
+	std::vector<time_t> _spawn_times;
+
+	Server(const Server&);
+	Server& operator=(const Server&);
 
 public:
 	Server(const std::string& config_file);
 	~Server();
 
-	void run(); // Main event loop
+	void run(); // Runs every worker until shutdown
 
 private:
 	// Socket setup
-	void _setupSocket();
-	void _acceptNewClient();
-	void _handleClientData(int client_fd);
-	void _setNonBlocking(int fd);
-
-	// Request processing
-	void _processClientRequest(int client_fd);
-	void _handleRequest(int client_fd, HttpRequest& request);
-	HttpResponse _buildResponse(const HttpRequest& request);
-
-	// CGI handling
-	void _handleCgiRequest(int client_fd, const HttpRequest& request);
-
-	// Output handling
-	void _sendToClient(int client_fd, const std::string& data);
-	void _flushClientBuffer(int client_fd);
+	void _setupWorkers();
+	void _setupListeners();
+	std::vector<int> _openListeners(bool reuse_port);
+	int _openListener(const ListenEndpoint& endpoint, bool reuse_port);
 
-	// Client management
-	void _removeClient(int client_fd);
-	void _cleanupTimedOutClients();
+	// Thread mode
+	void _runWorkers();
+	static void* _workerMain(void* arg);
 
-	// Helper methods
-	std::string _readFile(const std::string& path);
-	std::string _getContentType(const std::string& path);
-	bool _fileExists(const std::string& path);
+	// Process mode
+	void _runMaster();
+	pid_t _spawnChild(size_t slot);
+	void _runChild();
+	void _stopChildren();
 };
 
 #endif // SERVER_HPP
@@ -0,0 +1,31 @@
+#ifndef SHAREDFILE_HPP
+#define SHAREDFILE_HPP
+
+#include <cstddef>
+
+// Reference-counted open file descriptor, closed when the last copy goes.
+// Lets a response hand its file to an output queue, which sends it with
+// sendfile() long after the response itself is gone. Like SharedBuffer,
+// the count is not atomic: a file never leaves the worker that opened it.
+class SharedFile {
+private:
+	struct Handle {
+		size_t refs;
+		int fd;
+	};
+	Handle* _handle;
+
+	void _release();
+
+public:
+	SharedFile();
+	explicit SharedFile(int fd); // Takes ownership of fd
+	SharedFile(const SharedFile& other);
+	SharedFile& operator=(const SharedFile& other);
+	~SharedFile();
+
+	int fd() const { return _handle ? _handle->fd : -1; }
+	bool valid() const { return _handle != NULL; }
+};
+
+#endif // SHAREDFILE_HPP
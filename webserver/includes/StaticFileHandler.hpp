@@ -5,6 +5,8 @@
 #include "HttpResponse.hpp"
 #include <string>
 
+#define STATIC_DEFAULT_FILE "index.html" // Served for a directory
+
 class StaticFileHandler {
 private:
     std::string root_directory;
@@ -12,16 +14,13 @@ private:
     std::string default_file;
     
     std::string getMimeType(const std::string& path) const;
-    std::string readFile(const std::string& path, bool& success) const;
-    bool fileExists(const std::string& path) const;
-    bool isDirectory(const std::string& path) const;
-    std::string generateDirectoryListing(const std::string& path, const std::string& uri) const;
-    std::string combinePaths(const std::string& base, const std::string& relative) const;
-    bool isPathSafe(const std::string& path) const;
+    std::string generateDirectoryListing(int dir_fd, const std::string& uri) const;
+    HttpResponse serveFile(int root_fd, const std::string& uri) const;
+    HttpResponse deleteFile(int root_fd, const std::string& uri) const;
     
 public:
     StaticFileHandler(const std::string& root, bool dir_listing = false, 
-                     const std::string& default_file = "index.html");
+                     const std::string& default_file = STATIC_DEFAULT_FILE);
     
     HttpResponse handleRequest(const HttpRequest& request);
     
@@ -0,0 +1,27 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+// Per-worker counters. Each worker only touches its own copy, so plain
+// integers are enough; they are reported by `stub_status` locations.
+struct WorkerStats {
+	unsigned long accepted;
+	unsigned long accept_errors;
+	unsigned long accept_batches_full; // Batches that hit accept_batch with connections still queued
+	unsigned long accept_queue_peak;   // Deepest accept queue observed (TCP_INFO)
+	unsigned long active_connections;
+	unsigned long requests;            // Requests answered (including error responses)
+	unsigned long output_queued;       // Response bytes waiting in all output queues
+	unsigned long output_queue_peak;   // Largest single connection's queue observed
+	unsigned long backpressure_pauses; // Times a connection crossed output_high_watermark
+	unsigned long paused_connections;  // Connections currently not being read
+	unsigned long header_deadline_kills; // Closed for not finishing the request head in time
+	unsigned long slow_body_kills;       // Closed for sending the body below client_body_min_rate
+
+	WorkerStats()
+		: accepted(0), accept_errors(0), accept_batches_full(0),
+		  accept_queue_peak(0), active_connections(0), requests(0), output_queued(0),
+		  output_queue_peak(0), backpressure_pauses(0), paused_connections(0),
+		  header_deadline_kills(0), slow_body_kills(0) {}
+};
+
+#endif // STATS_HPP
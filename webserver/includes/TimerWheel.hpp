@@ -0,0 +1,60 @@
+#ifndef TIMERWHEEL_HPP
+#define TIMERWHEEL_HPP
+
+#include <vector>
+#include <cstddef>
+
+#define TIMER_TICK_MS 100 // Wheel resolution
+#define TIMER_LEVEL_BITS 6
+#define TIMER_SLOTS (1 << TIMER_LEVEL_BITS) // Slots per level
+#define TIMER_LEVELS 4 // 64^4 ticks of 100ms: ~19 days of range
+
+// Intrusive timer: lives inside its owner (e.g. a Client), so arming and
+// cancelling never allocate. Unlinks itself when destroyed.
+struct TimerNode {
+	TimerNode* prev;
+	TimerNode* next;
+	unsigned long expires; // Absolute tick
+	int id;                // Owner identifier (client fd)
+	int kind;              // Owner-defined reason for the timer
+
+	TimerNode();
+	~TimerNode();
+
+	bool isArmed() const { return next != NULL; }
+	void unlink();
+
+private:
+	TimerNode(const TimerNode&);
+	TimerNode& operator=(const TimerNode&);
+};
+
+// Hierarchical timing wheel (Varghese & Lauck): O(1) arm, re-arm and cancel;
+// advancing costs O(1) per elapsed tick plus O(1) per expired timer.
+// Far-away timers sit in coarser levels and cascade down as time passes.
+class TimerWheel {
+private:
+	TimerNode _slots[TIMER_LEVELS][TIMER_SLOTS]; // List heads (sentinels)
+	unsigned long _current; // Next tick to process
+
+	void _insert(TimerNode& node);
+	void _cascade(int level);
+
+	TimerWheel(const TimerWheel&);
+	TimerWheel& operator=(const TimerWheel&);
+
+public:
+	TimerWheel(unsigned long now_ms);
+
+	// (Re-)arm `node` to fire `delay_ms` from `now_ms`
+	void arm(TimerNode& node, unsigned long now_ms, unsigned long delay_ms);
+	void cancel(TimerNode& node);
+
+	// Process every tick up to `now_ms`, collecting nodes that fired
+	void advance(unsigned long now_ms, std::vector<TimerNode*>& expired);
+
+	// Milliseconds until the next timer fires, capped at `max_ms`
+	int nextTimeout(unsigned long now_ms, int max_ms) const;
+};
+
+#endif // TIMERWHEEL_HPP
@@ -6,10 +6,11 @@
 #include <string>
 #include <vector>
 
+// A file part of a multipart body; its content stays in the request body
 struct UploadedFile {
     std::string filename;
     std::string content_type;
-    std::string content;
+    size_t offset; // Start of the content within the body
     size_t size;
 };
 
@@ -18,9 +19,9 @@ private:
     std::string upload_directory;
     size_t max_upload_size;
     
-    bool parseMultipartFormData(const std::string& body, const std::string& boundary,
+    bool parseMultipartFormData(const RequestBody& body, const std::string& boundary,
                                std::vector<UploadedFile>& files);
-    bool saveFile(const std::string& filename, const std::string& content);
+    bool saveFile(const std::string& filename, const RequestBody& body, size_t offset, size_t size);
     std::string sanitizeFilename(const std::string& filename) const;
     bool directoryExists(const std::string& path) const;
     bool createDirectory(const std::string& path) const;
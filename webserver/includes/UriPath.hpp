@@ -0,0 +1,23 @@
+#ifndef URIPATH_HPP
+#define URIPATH_HPP
+
+#include <string>
+#include <cstddef>
+
+// Request paths and the files they name.
+// A request target is percent-decoded and normalized in one pass: repeated
+// slashes collapse, "." segments drop and ".." removes the previous segment.
+// Files are then opened relative to a root directory descriptor, so the
+// kernel, not a string check, keeps them inside it.
+
+// Decode and normalize an origin-form path ("/a/%2e/b//c" -> "/a/b/c").
+// False if it is malformed, contains NUL, or climbs above "/".
+bool normalizeUriPath(const char* path, size_t length, std::string& out);
+
+// openat() that can't leave dir_fd: absolute paths, ".." and symlinks
+// pointing outside fail with EXDEV. Uses openat2(RESOLVE_BENEATH) when the
+// kernel has it, otherwise walks the path refusing symlinks. path is
+// relative to dir_fd; "" opens dir_fd itself. Returns -1 with errno set.
+int openBeneath(int dir_fd, const char* path, int flags, int mode = 0);
+
+#endif // URIPATH_HPP
@@ -0,0 +1,126 @@
+#ifndef URINGREACTOR_HPP
+#define URINGREACTOR_HPP
+
+#include "Reactor.hpp"
+#include <vector>
+
+#if defined(__linux__) && defined(__has_include)
+# if __has_include(<linux/io_uring.h>)
+#  include <linux/io_uring.h>
+#  ifdef IORING_RECV_MULTISHOT // 6.0 headers: multishot recv, provided buffer rings
+#   define WEBSERV_HAVE_IO_URING 1
+#  endif
+# endif
+#endif
+
+#ifdef WEBSERV_HAVE_IO_URING
+# include <sys/socket.h>
+
+#define URING_ENTRIES 4096
+#define URING_RECV_BUFFERS 256     // Provided buffers for multishot recv (power of two)
+#define URING_RECV_BUFFER_SIZE 8192
+#define URING_IOV_MAX 64           // Segments in one send
+
+// io_uring(7) backend. Accepts, receives, sends and file reads run as
+// io_uring operations: multishot accept and multishot recv (which picks
+// its buffers from a provided buffer ring) stay armed across many
+// completions, and everything queued while handling one batch of events
+// goes to the kernel with the single io_uring_enter() that also waits for
+// the next batch.
+//
+// Readiness for other fds (add/modify/remove) is requested with one-shot
+// IORING_OP_POLL_ADD requests that are re-armed after each completion,
+// which keeps poll(2)'s level-triggered semantics.
+class UringReactor : public Reactor {
+private:
+	struct FdState {
+		int events;        // Requested EVENT_* mask
+		unsigned int gen;  // Bumped on every change; stale completions carry an old one
+		bool registered;
+		bool armed;        // A poll request is in flight
+
+		FdState() : events(0), gen(0), registered(false), armed(false) {}
+	};
+
+	// A send's message header and iovecs, kept until the send completes
+	struct SendSlot {
+		struct msghdr message;
+		struct iovec iov[URING_IOV_MAX];
+	};
+
+	int _ring_fd;
+	unsigned int _features;
+
+	// Submission ring
+	void* _sq_ptr;
+	size_t _sq_size;
+	unsigned int* _sq_head;
+	unsigned int* _sq_tail;
+	unsigned int* _sq_mask;
+	unsigned int* _sq_array;
+	struct io_uring_sqe* _sqes;
+	size_t _sqes_size;
+	unsigned int _sq_entries;
+	unsigned int _sq_local_tail; // Published to the kernel on each enter
+
+	// Completion ring
+	void* _cq_ptr;
+	size_t _cq_size;
+	unsigned int* _cq_head;
+	unsigned int* _cq_tail;
+	unsigned int* _cq_mask;
+	struct io_uring_cqe* _cqes;
+
+	// Provided buffer ring: the kernel takes a buffer for each receive;
+	// we give it back once the batch it was reported in has been handled.
+	// Its tail overlays the first entry's resv field (io_uring_buf_ring,
+	// whose flexible array member C++ lays out differently).
+	struct io_uring_buf* _buf_ring;
+	size_t _buf_ring_size;
+	std::vector<char> _buffers;
+	unsigned short _buf_tail;
+	std::vector<unsigned short> _lent; // Buffer ids reported by the last wait()
+
+	std::vector<FdState> _fds;        // Indexed by fd
+	std::vector<int> _ready_idx;      // fd -> slot in the output batch, -1 if none
+	std::vector<int> _rearm;          // Fds whose one-shot poll completed
+	std::vector<SendSlot*> _send_slots; // Indexed by fd, allocated on first send
+
+	void _setup(unsigned int entries);
+	void _setupBuffers();
+	void _teardown();
+	void _giveBuffer(unsigned short id);
+	void _returnBuffers();
+	unsigned int _pending() const;
+	struct io_uring_sqe* _getSqe();
+	int _enter(unsigned int min_complete, int timeout_ms);
+	void _queuePoll(int fd);
+	void _queueCancel(int fd);
+	void _pollEvent(const struct io_uring_cqe& cqe, int fd, std::vector<ReactorEvent>& events);
+	static unsigned long long _userData(int fd, int op, unsigned int gen);
+
+	UringReactor(const UringReactor&);
+	UringReactor& operator=(const UringReactor&);
+
+public:
+	UringReactor();
+	virtual ~UringReactor();
+
+	virtual bool add(int fd, int events);
+	virtual bool modify(int fd, int events);
+	virtual void remove(int fd);
+	virtual int wait(std::vector<ReactorEvent>& events, int timeout_ms);
+	virtual const char* name() const { return "io_uring"; }
+
+	virtual bool completesIo() const { return true; }
+	virtual bool acceptMultishot(int listen_fd);
+	virtual bool recvMultishot(int fd);
+	virtual bool send(int fd, const struct iovec* iov, int count, bool more);
+	virtual bool readFile(int fd, int file_fd, off_t offset, char* buffer, size_t length);
+	virtual void cancelRecv(int fd);
+	virtual void cancel(int fd);
+};
+
+#endif // WEBSERV_HAVE_IO_URING
+
+#endif // URINGREACTOR_HPP
@@ -0,0 +1,38 @@
+#ifndef VIRTUALHOSTTABLE_HPP
+#define VIRTUALHOSTTABLE_HPP
+
+#include <string>
+#include <vector>
+
+// Open-addressing hash table: (listen endpoint, server_name) -> server index.
+// Built once at config load; lookups are case-insensitive and never allocate.
+class VirtualHostTable {
+private:
+	struct Entry {
+		std::string name; // Lowercased
+		size_t endpoint;
+		size_t server;
+		size_t hash;
+		bool used;
+
+		Entry() : endpoint(0), server(0), hash(0), used(false) {}
+	};
+
+	std::vector<Entry> _entries; // Capacity is a power of two
+	size_t _count;
+
+	static size_t _hash(size_t endpoint, const char* name, size_t len);
+	static bool _equals(const std::string& stored, const char* name, size_t len);
+	void _grow();
+
+public:
+	VirtualHostTable();
+
+	// First registration of a name on an endpoint wins, like nginx
+	void insert(size_t endpoint, const std::string& name, size_t server);
+	bool find(size_t endpoint, const char* name, size_t len, size_t& server) const;
+	void clear();
+	size_t size() const { return _count; }
+};
+
+#endif // VIRTUALHOSTTABLE_HPP
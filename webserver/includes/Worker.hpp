@@ -0,0 +1,135 @@
+#ifndef WORKER_HPP
+#define WORKER_HPP
+
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <ctime>
+#include "TimerWheel.hpp"
+#include "Stats.hpp"
+#include "ErrorPages.hpp"
+#include "FileCache.hpp"
+
+#define BUFFER_SIZE 8192
+#define MAX_WAIT_MS 1000 // Upper bound on a wait, so shutdown is noticed
+#define LINGERING_TIMEOUT_MS 5000 // How long a rejected client may keep sending after the response
+#define FILE_READ_MAX 65536 // Larger file regions go out with sendfile when the reactor does the I/O
+
+// What a client's timer is waiting for
+enum TimeoutKind {
+	TIMEOUT_HEADER,
+	TIMEOUT_BODY,
+	TIMEOUT_KEEPALIVE,
+	TIMEOUT_SEND,
+	TIMEOUT_LINGER,
+	TIMEOUT_HEADER_DEADLINE, // Whole request head took too long
+	TIMEOUT_BODY_RATE        // Time to check the body's transfer rate
+};
+
+class Client;
+class Config;
+class HttpRequest;
+class HttpResponse;
+class Reactor;
+struct ReactorEvent;
+struct ServerConfig;
+struct LocationConfig;
+
+// One event loop: its own listening sockets, reactor, client table and
+// output queues. Nothing here is shared with other workers, so a worker
+// can run on its own thread without any locking.
+class Worker {
+private:
+	const Config& _config;
+	int _id;
+	std::vector<int> _listen_fds; // One per config endpoint, same order
+	Reactor* _reactor;
+	bool _completion; // The reactor does the socket and file I/O (io_uring)
+	std::vector<Client*> _clients; // Indexed by fd, NULL when unused
+	std::vector<Client*> _retiring; // Removed, waiting for their last operations (by fd)
+	std::vector<int> _output_ready; // Clients to start output for before the next wait
+	TimerWheel _timers;
+	unsigned long _now_ms; // Monotonic time, sampled once per loop iteration
+	time_t _date_second; // Wall-clock second _date was formatted for
+	std::string _date; // Date header value, shared by every response
+	std::vector<TimerNode*> _expired;
+	WorkerStats _stats;
+	ErrorPages _error_pages;
+	FileCache _file_cache;
+
+	Worker(const Worker&);
+	Worker& operator=(const Worker&);
+
+public:
+	// Takes ownership of the listening sockets
+	Worker(const Config& config, int id, const std::vector<int>& listen_fds);
+	~Worker();
+
+	void run(); // Main event loop
+	int getId() const { return _id; }
+
+private:
+	// Socket handling
+	int _findListener(int fd) const;
+	void _acceptClients(size_t endpoint);
+	int _acceptOne(int listen_fd);
+	void _addClient(int client_fd, size_t endpoint);
+	void _sampleAcceptQueue(int listen_fd);
+	void _handleClientData(int client_fd);
+	void _receive(int client_fd, const char* data, int bytes_read);
+	void _setNonBlocking(int fd);
+
+	// Completion-based I/O
+	void _handleCompletion(const ReactorEvent& event);
+	void _completeAccept(const ReactorEvent& event);
+	void _completeRecv(Client* client, const ReactorEvent& event);
+	void _completeSend(Client* client, int result);
+	void _completeRead(Client* client, int result);
+	void _updateOperations(Client* client, bool reading);
+	void _startOutput();
+	void _submitOutput(Client* client);
+
+	// Request processing
+	bool _processRequests(int client_fd);
+	void _handleRequest(int client_fd, HttpRequest& request);
+	const ServerConfig& _resolveServer(const Client* client, const HttpRequest& request) const;
+	HttpResponse _buildResponse(const HttpRequest& request, const ServerConfig& server_config,
+								const LocationConfig* location);
+	HttpResponse _statusResponse() const;
+
+	// CGI handling
+	void _handleCgiRequest(int client_fd, const HttpRequest& request);
+
+	// Output handling
+	void _queueResponse(int client_fd, HttpResponse& response, bool with_body);
+	bool _queueErrorPage(int client_fd, const ServerConfig& server, int code, bool with_body);
+	void _queuePrebuilt(int client_fd, const SharedBuffer& head, const SharedBuffer* body);
+	void _sendToClient(int client_fd, std::string& data);
+	void _sendToClient(int client_fd, const SharedBuffer& buffer);
+	void _sendToClient(int client_fd, const SharedFile& file, size_t length);
+	void _flushClientBuffer(int client_fd);
+	void _outputProgress(Client* client);
+	void _updateInterest(Client* client);
+	bool _closeIfDrained(Client* client);
+
+	// Client management
+	Client* _getClient(int fd) const;
+	void _removeClient(int client_fd);
+
+	// Timeouts
+	static unsigned long _monotonicMs();
+	void _updateClock();
+	void _updateTimer(Client* client);
+	void _expireTimers();
+	bool _bodyRateTooLow(Client* client) const;
+
+	// Helper methods
+	std::string _readFile(const std::string& path);
+	std::string _getContentType(const std::string& path);
+	bool _fileExists(const std::string& path);
+};
+
+#endif // WORKER_HPP
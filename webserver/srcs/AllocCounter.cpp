@@ -0,0 +1,40 @@
+#include "AllocCounter.hpp"
+
+#ifdef WEBSERV_COUNT_ALLOCS
+
+#include <cstdlib>
+#include <new>
+
+static long g_allocations = 0;
+
+void* operator new(size_t size) throw(std::bad_alloc) {
+	__sync_fetch_and_add(&g_allocations, 1);
+	void* p = std::malloc(size ? size : 1);
+	if (!p)
+		throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](size_t size) throw(std::bad_alloc) {
+	return operator new(size);
+}
+
+void operator delete(void* p) throw() {
+	std::free(p);
+}
+
+void operator delete[](void* p) throw() {
+	std::free(p);
+}
+
+long heapAllocations() {
+	return __sync_fetch_and_add(&g_allocations, 0);
+}
+
+#else
+
+long heapAllocations() {
+	return -1;
+}
+
+#endif
@@ -0,0 +1,59 @@
+#include "Arena.hpp"
+
+__thread Arena* Arena::active = NULL;
+
+// Block header, padded so the first allocation stays aligned
+static const size_t BLOCK_HEADER = 16;
+
+Arena::Arena() : blocks(NULL), cursor(NULL), limit(NULL), used(0) {}
+
+Arena::~Arena() {
+    release();
+}
+
+void Arena::release() {
+    while (blocks) {
+        Block* next = blocks->next;
+        ::operator delete(blocks);
+        blocks = next;
+    }
+    cursor = NULL;
+    limit = NULL;
+}
+
+void Arena::addBlock(size_t min_size) {
+    size_t size = blocks ? blocks->size * 2 : ARENA_BLOCK_SIZE;
+    if (size < min_size)
+        size = min_size;
+
+    Block* block = static_cast<Block*>(::operator new(BLOCK_HEADER + size));
+    block->next = blocks;
+    block->size = size;
+    blocks = block;
+    cursor = reinterpret_cast<char*>(block) + BLOCK_HEADER;
+    limit = cursor + size;
+}
+
+void Arena::reset() {
+    if (blocks && blocks->next) {
+        // Outgrew one block: replace them with one that fits next time,
+        // unless this request was an outlier
+        size_t total = used;
+        release();
+        if (total <= ARENA_RETAIN_SIZE)
+            addBlock(total);
+    } else if (blocks) {
+        cursor = reinterpret_cast<char*>(blocks) + BLOCK_HEADER;
+        limit = cursor + blocks->size;
+    }
+    used = 0;
+}
+
+ArenaScope::ArenaScope(Arena& scoped) : arena(scoped), previous(Arena::active) {
+    Arena::active = &arena;
+}
+
+ArenaScope::~ArenaScope() {
+    Arena::active = previous;
+    arena.reset();
+}
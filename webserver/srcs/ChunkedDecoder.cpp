@@ -0,0 +1,163 @@
+#include "ChunkedDecoder.hpp"
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+ChunkedDecoder::ChunkedDecoder() {
+    reset(static_cast<size_t>(-1));
+}
+
+void ChunkedDecoder::reset(size_t max_body_size) {
+    state = CHUNK_SIZE;
+    chunk_size = 0;
+    size_digits = 0;
+    extension_bytes = 0;
+    trailer_bytes = 0;
+    decoded = 0;
+    max_size = max_body_size;
+    error_code = 0;
+}
+
+size_t ChunkedDecoder::fail(int code) {
+    state = FAILED;
+    error_code = code;
+    return 0;
+}
+
+// Size line complete: a zero size starts the trailer section
+bool ChunkedDecoder::endSizeLine() {
+    if (chunk_size == 0) {
+        state = TRAILER_START;
+        return true;
+    }
+    if (chunk_size > max_size - decoded) {
+        fail(413); // Payload Too Large
+        return false;
+    }
+    state = CHUNK_DATA;
+    return true;
+}
+
+size_t ChunkedDecoder::feed(const char* data, size_t length, BodySink& sink) {
+    size_t pos = 0;
+
+    while (pos < length && state != DONE && state != FAILED) {
+        char c = data[pos];
+
+        switch (state) {
+            case CHUNK_SIZE: {
+                int digit = hexValue(c);
+                if (digit >= 0) {
+                    // Leading zeros are fine, values past size_t are not
+                    if (chunk_size > (static_cast<size_t>(-1) >> 4))
+                        return fail(413);
+                    chunk_size = (chunk_size << 4) | digit;
+                    size_digits++;
+                    pos++;
+                    break;
+                }
+                if (size_digits == 0)
+                    return fail(400);
+                if (c == ';' || c == ' ' || c == '\t') {
+                    state = CHUNK_EXTENSION;
+                } else if (c == '\r') {
+                    state = CHUNK_SIZE_LF;
+                } else if (c == '\n') {
+                    if (!endSizeLine())
+                        return pos;
+                } else {
+                    return fail(400);
+                }
+                pos++;
+                break;
+            }
+
+            case CHUNK_EXTENSION:
+                // Extensions are ignored, only their length is bounded
+                if (c == '\r') {
+                    state = CHUNK_SIZE_LF;
+                } else if (c == '\n') {
+                    if (!endSizeLine())
+                        return pos;
+                } else if (++extension_bytes > MAX_CHUNK_EXTENSION) {
+                    return fail(400);
+                }
+                pos++;
+                break;
+
+            case CHUNK_SIZE_LF:
+                if (c != '\n')
+                    return fail(400);
+                pos++;
+                if (!endSizeLine())
+                    return pos;
+                break;
+
+            case CHUNK_DATA: {
+                size_t take = length - pos;
+                if (take > chunk_size)
+                    take = chunk_size;
+                if (!sink.write(data + pos, take))
+                    return fail(500);
+                pos += take;
+                decoded += take;
+                chunk_size -= take;
+                if (chunk_size == 0)
+                    state = CHUNK_DATA_CR;
+                break;
+            }
+
+            case CHUNK_DATA_CR:
+                if (c == '\r')
+                    state = CHUNK_DATA_LF;
+                else if (c == '\n')
+                    state = CHUNK_SIZE;
+                else
+                    return fail(400);
+                size_digits = 0;
+                extension_bytes = 0;
+                pos++;
+                break;
+
+            case CHUNK_DATA_LF:
+                if (c != '\n')
+                    return fail(400);
+                state = CHUNK_SIZE;
+                pos++;
+                break;
+
+            case TRAILER_START:
+                if (c == '\r')
+                    state = FINAL_LF;
+                else if (c == '\n')
+                    state = DONE;
+                else
+                    state = TRAILER_LINE;
+                pos++;
+                break;
+
+            case TRAILER_LINE:
+                if (++trailer_bytes > MAX_TRAILER_SIZE)
+                    return fail(431);
+                if (c == '\n')
+                    state = TRAILER_START;
+                pos++;
+                break;
+
+            case FINAL_LF:
+                if (c != '\n')
+                    return fail(400);
+                state = DONE;
+                pos++;
+                break;
+
+            default:
+                break;
+        }
+    }
+    return pos;
+}
@@ -1,8 +1,15 @@
 #include "Client.hpp"
 
-Client::Client() : _fd(-1), _last_activity(time(NULL)) {}
+Client::Client()
+	: _fd(-1), _endpoint(0), _request_count(0), _closing(false), _paused(false), _lingering(false),
+	  _events(0), _io(0), _request_start(0), _rate_mark(0), _rate_mark_bytes(0) {}
 
-Client::Client(int fd) : _fd(fd), _last_activity(time(NULL)) {}
+Client::Client(int fd, size_t endpoint)
+	: _fd(fd), _endpoint(endpoint), _request_count(0), _closing(false), _paused(false), _lingering(false),
+	  _events(0), _io(0), _request_start(0), _rate_mark(0), _rate_mark_bytes(0) {
+	_timer.id = fd;
+	_request.requireBodyLimit(); // The limit depends on the Host header
+}
 
 Client::~Client() {}
 
@@ -11,6 +18,10 @@ int Client::getFd() const {
 	return _fd;
 }
 
+size_t Client::getEndpoint() const {
+	return _endpoint;
+}
+
 HttpRequest& Client::getRequest() {
 	return _request;
 }
@@ -19,16 +30,94 @@ const HttpRequest& Client::getRequest() const {
 	return _request;
 }
 
-time_t Client::getLastActivity() const {
-	return _last_activity;
+size_t Client::getRequestCount() const {
+	return _request_count;
+}
+
+TimerNode& Client::getTimer() {
+	return _timer;
+}
+
+OutputQueue& Client::getOutput() {
+	return _output;
+}
+
+Arena& Client::getArena() {
+	return _arena;
+}
+
+bool Client::isClosing() const {
+	return _closing;
+}
+
+void Client::setClosing() {
+	_closing = true;
+}
+
+bool Client::isPaused() const {
+	return _paused;
+}
+
+void Client::setPaused(bool paused) {
+	_paused = paused;
+}
+
+bool Client::isLingering() const {
+	return _lingering;
+}
+
+// Close without reading further requests, but keep draining what the peer
+// still sends, so the kernel doesn't reset the connection under the response
+void Client::setLingering() {
+	_closing = true;
+	_lingering = true;
+}
+
+int Client::getEvents() const {
+	return _events;
+}
+
+void Client::setEvents(int events) {
+	_events = events;
+}
+
+int Client::getIo() const {
+	return _io;
+}
+
+void Client::setIo(int io) {
+	_io = io;
+}
+
+std::string& Client::getChunk() {
+	return _chunk;
+}
+
+unsigned long Client::getRequestStart() const {
+	return _request_start;
+}
+
+void Client::setRequestStart(unsigned long now_ms) {
+	_request_start = now_ms;
+}
+
+unsigned long Client::getRateMark() const {
+	return _rate_mark;
+}
+
+size_t Client::getRateMarkBytes() const {
+	return _rate_mark_bytes;
 }
 
-// Activity tracking
-void Client::updateActivity() {
-	_last_activity = time(NULL);
+// Start a new body rate window
+void Client::markBodyRate(unsigned long now_ms, size_t body_bytes) {
+	_rate_mark = now_ms;
+	_rate_mark_bytes = body_bytes;
 }
 
 // Request management
+// Bytes of the next pipelined request are parsed without another recv
 void Client::resetRequest() {
-	_request = HttpRequest();
+	_request.startNext();
+	_request_count++;
 }
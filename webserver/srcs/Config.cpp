@@ -1,14 +1,31 @@
 #include "Config.hpp"
+#include "Reactor.hpp"
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <algorithm>
 #include <vector>
 #include <cstdlib>
-
-Config::Config() {}
-
-Config::Config(const std::string& config_file) : _config_file(config_file) {}
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+Config::Config()
+	: _event_backend("auto"), _worker_threads(1), _worker_processes(0),
+	  _listen_backlog(DEFAULT_LISTEN_BACKLOG), _accept_batch(DEFAULT_ACCEPT_BATCH),
+	  _keepalive_requests(DEFAULT_KEEPALIVE_REQUESTS),
+	  _output_high_watermark(DEFAULT_OUTPUT_HIGH_WATERMARK),
+	  _output_low_watermark(DEFAULT_OUTPUT_LOW_WATERMARK),
+	  _file_cache_size(DEFAULT_FILE_CACHE_SIZE), _file_cache_max_file(DEFAULT_FILE_CACHE_MAX_FILE) {}
+
+Config::Config(const std::string& config_file)
+	: _config_file(config_file), _event_backend("auto"), _worker_threads(1), _worker_processes(0),
+	  _listen_backlog(DEFAULT_LISTEN_BACKLOG), _accept_batch(DEFAULT_ACCEPT_BATCH),
+	  _keepalive_requests(DEFAULT_KEEPALIVE_REQUESTS),
+	  _output_high_watermark(DEFAULT_OUTPUT_HIGH_WATERMARK),
+	  _output_low_watermark(DEFAULT_OUTPUT_LOW_WATERMARK),
+	  _file_cache_size(DEFAULT_FILE_CACHE_SIZE), _file_cache_max_file(DEFAULT_FILE_CACHE_MAX_FILE) {}
 
 Config::~Config() {}
 
@@ -17,7 +34,11 @@ bool Config::parse() {
 	if (!_config_file.empty()) {
 		try {
 			_parseConfigFile(_config_file);
-			return !_servers.empty();
+			if (_servers.empty())
+				return false;
+			_buildVirtualHosts();
+			_loadErrorPages();
+			return true;
 		} catch (const std::exception& e) {
 			std::cerr << "Config parse error: " << e.what() << std::endl;
 			// Fall back to default configuration
@@ -59,10 +80,13 @@ bool Config::parse() {
 	default_config.locations.push_back(upload_location);
 
 	// Default error pages
-	default_config.error_pages[404] = "./www/404.html";
-	default_config.error_pages[500] = "./www/500.html";
+	default_config.error_pages[404] = "/errors/404.html";
+	default_config.error_pages[500] = "/errors/500.html";
 
+	default_config.server_names.push_back(default_config.server_name);
 	_servers.push_back(default_config);
+	_buildVirtualHosts();
+	_loadErrorPages();
 
 	return true;
 }
@@ -75,6 +99,86 @@ const ServerConfig& Config::getServerConfig(size_t index) const {
 	return _servers[index];
 }
 
+const std::string& Config::getEventBackend() const {
+	return _event_backend;
+}
+
+const std::vector<ListenEndpoint>& Config::getEndpoints() const {
+	return _endpoints;
+}
+
+// Pick the server block for a request from the endpoint it arrived on and
+// its Host header; unknown names fall back to the endpoint's default server
+const ServerConfig& Config::resolveServer(size_t endpoint, const std::string& host_header) const {
+	return resolveServer(endpoint, host_header.data(), host_header.length());
+}
+
+const ServerConfig& Config::resolveServer(size_t endpoint, const char* host_header, size_t length) const {
+	const ListenEndpoint& listen = _endpoints[endpoint];
+
+	// Strip the port (and brackets of an IPv6 literal) and a trailing dot
+	const char* name = host_header;
+	size_t len = length;
+	if (len > 0 && name[0] == '[') {
+		const char* close = static_cast<const char*>(std::memchr(name, ']', len));
+		if (close) {
+			name += 1;
+			len = close - name;
+		}
+	} else {
+		const char* colon = static_cast<const char*>(std::memchr(name, ':', len));
+		if (colon)
+			len = colon - name;
+	}
+	if (len > 0 && name[len - 1] == '.')
+		len--;
+
+	size_t server;
+	if (len > 0 && _vhosts.find(endpoint, name, len, server))
+		return _servers[server];
+	return _servers[listen.default_server];
+}
+
+int Config::getWorkerThreads() const {
+	return _worker_threads;
+}
+
+int Config::getWorkerProcesses() const {
+	return _worker_processes;
+}
+
+const Timeouts& Config::getTimeouts() const {
+	return _timeouts;
+}
+
+int Config::getListenBacklog() const {
+	return _listen_backlog;
+}
+
+int Config::getAcceptBatch() const {
+	return _accept_batch;
+}
+
+int Config::getKeepaliveRequests() const {
+	return _keepalive_requests;
+}
+
+size_t Config::getOutputHighWatermark() const {
+	return _output_high_watermark;
+}
+
+size_t Config::getOutputLowWatermark() const {
+	return _output_low_watermark;
+}
+
+size_t Config::getFileCacheSize() const {
+	return _file_cache_size;
+}
+
+size_t Config::getFileCacheMaxFile() const {
+	return _file_cache_max_file;
+}
+
 const LocationConfig* Config::findLocation(const std::string& uri, const ServerConfig& server) const {
 	const LocationConfig* best_match = NULL;
 	size_t best_match_len = 0;
@@ -92,23 +196,80 @@ const LocationConfig* Config::findLocation(const std::string& uri, const ServerC
 	return best_match;
 }
 
+// Read every server's error pages once, so serving one never touches the
+// disk. A path starting with '/' is a URI under the root of the location
+// it matches, like a request would be; others are filesystem paths.
+// Pages that can't be read are left out, and the built-in page is used.
+void Config::_loadErrorPages() {
+	for (size_t i = 0; i < _servers.size(); ++i) {
+		ServerConfig& server = _servers[i];
+		server.error_page_bodies.clear();
+		for (std::map<int, std::string>::const_iterator it = server.error_pages.begin();
+			 it != server.error_pages.end(); ++it) {
+			std::string path = it->second;
+			const LocationConfig* location = path[0] == '/' ? findLocation(path, server) : NULL;
+			if (location && !location->root.empty())
+				path = location->root + path;
+
+			std::ifstream file(path.c_str(), std::ios::binary);
+			if (!file.is_open()) {
+				std::cerr << "Warning: error_page " << it->first << ": cannot read " << path << std::endl;
+				continue;
+			}
+			std::ostringstream contents;
+			contents << file.rdbuf();
+			server.error_page_bodies[it->first] = contents.str();
+		}
+	}
+}
+
 // Extract server-level directives and location blocks
 void Config::_parseServerBlock(const std::string& block, ServerConfig& config) {
-	std::vector<std::string> lines = _split(block, '\n');
+	size_t pos = 0;
 
-	for (size_t i = 0; i < lines.size(); ++i)
+	// Walk statements (terminated by ';') and nested blocks ('{ ... }')
+	while ((pos = block.find_first_not_of(" \t\r\n", pos)) != std::string::npos)
 	{
-		std::string line = _trim(lines[i]);
-		if (line.empty() || line[0] == '#') continue;
+		size_t stmt_end = block.find_first_of(";{", pos);
+		if (stmt_end == std::string::npos)
+			throw std::runtime_error("Unterminated directive: " + _trim(block.substr(pos)));
+		std::string line = _trim(block.substr(pos, stmt_end - pos));
+
+		if (block[stmt_end] == '{')
+		{
+			size_t end = _findClosingBrace(block, stmt_end);
+			if (end == std::string::npos)
+				throw std::runtime_error("Unclosed block: " + line);
+			if (line.find("location") == 0)
+			{
+				std::string loc_block = block.substr(stmt_end + 1, end - stmt_end - 1);
+
+				std::vector<std::string> tokens = _tokenize(line);
+				LocationConfig location;
+				if (tokens.size() >= 2)
+					location.path = tokens[1];
+
+				_parseLocationBlock(loc_block, location);
+				config.locations.push_back(location);
+			}
+			pos = end + 1;
+			continue;
+		}
+		pos = stmt_end + 1;
 
 		if (line.find("listen") == 0)
 		{
-			std::vector<std::string> tokens = _split(line, ' ');
+			// listen <port> | listen <host>:<port>
+			std::vector<std::string> tokens = _tokenize(line);
 			if (tokens.size() >= 2)
 			{
 				std::string port_str = tokens[1];
-				if (port_str[port_str.length() - 1] == ';')
-					port_str = port_str.substr(0, port_str.length() - 1);
+				size_t colon = port_str.rfind(':');
+				if (colon != std::string::npos)
+				{
+					config.host = port_str.substr(0, colon);
+					port_str = port_str.substr(colon + 1);
+				}
 				config.port = std::atoi(port_str.c_str());
 			}
 		}
@@ -124,51 +285,40 @@ void Config::_parseServerBlock(const std::string& block, ServerConfig& config) {
 		}
 		else if (line.find("server_name") == 0)
 		{
-			std::vector<std::string> tokens = _split(line, ' ');
-			if (tokens.size() >= 2)
-			{
-				config.server_name = tokens[1];
-				if (config.server_name[config.server_name.length() - 1] == ';')
-					config.server_name = config.server_name.substr(0, config.server_name.length() - 1);
-			}
+			std::vector<std::string> tokens = _tokenize(line);
+			for (size_t j = 1; j < tokens.size(); ++j)
+				config.server_names.push_back(tokens[j]);
+			if (!config.server_names.empty())
+				config.server_name = config.server_names[0];
 		}
 		else if (line.find("max_body_size") == 0 || line.find("client_max_body_size") == 0)
 		{
-			std::vector<std::string> tokens = _split(line, ' ');
-			if (tokens.size() >= 2)
-			{
-				std::string size_str = tokens[1];
-				if (size_str[size_str.length() - 1] == ';')
-					size_str = size_str.substr(0, size_str.length() - 1);
-				config.max_body_size = std::atoi(size_str.c_str());
-			}
+			std::vector<std::string> tokens = _tokenize(line);
+			if (tokens.size() != 2)
+				throw std::runtime_error("client_max_body_size expects one value");
+			config.max_body_size = _parseSize(tokens[1]);
+		}
+		else if (line.find("client_body_buffer_size") == 0)
+		{
+			std::vector<std::string> tokens = _tokenize(line);
+			if (tokens.size() != 2)
+				throw std::runtime_error("client_body_buffer_size expects one value");
+			config.client_body_buffer_size = _parseSize(tokens[1]);
 		}
 		else if (line.find("error_page") == 0)
 		{
-			std::vector<std::string> tokens = _split(line, ' ');
-			if (tokens.size() >= 3)
+			// error_page code... path
+			std::vector<std::string> tokens = _tokenize(line);
+			if (tokens.size() < 3)
+				throw std::runtime_error("error_page expects codes and a path");
+			for (size_t i = 1; i + 1 < tokens.size(); ++i)
 			{
-				int error_code = std::atoi(tokens[1].c_str());
-				std::string error_path = tokens[2];
-				if (error_path[error_path.length() - 1] == ';')
-					error_path = error_path.substr(0, error_path.length() - 1);
-				config.error_pages[error_code] = error_path;
+				int error_code = std::atoi(tokens[i].c_str());
+				if (error_code < 300 || error_code > 599)
+					throw std::runtime_error("Invalid error_page code: " + tokens[i]);
+				config.error_pages[error_code] = tokens.back();
 			}
 		}
-		else if (line.find("location") == 0)
-		{
-			size_t start = block.find("{", i);
-			size_t end = _findClosingBrace(block, start);
-			std::string loc_block = block.substr(start + 1, end - start - 1);
-
-			std::vector<std::string> tokens = _split(line, ' ');
-			LocationConfig location;
-			if (tokens.size() >= 2)
-				location.path = tokens[1];
-
-			_parseLocationBlock(loc_block, location);
-			config.locations.push_back(location);
-		}
 	}
 }
 
@@ -234,6 +384,22 @@ void Config::_parseLocationBlock(const std::string& block, LocationConfig& locat
 					location.upload_path = location.upload_path.substr(0, location.upload_path.length() - 1);
 			}
 		}
+		else if (line.find("max_body_size") == 0 || line.find("client_max_body_size") == 0)
+		{
+			std::vector<std::string> tokens = _tokenize(line);
+			if (tokens.size() != 2)
+				throw std::runtime_error("client_max_body_size expects one value");
+			std::string size_str = tokens[1];
+			if (size_str[size_str.length() - 1] == ';')
+				size_str = size_str.substr(0, size_str.length() - 1);
+			location.max_body_size = _parseSize(size_str);
+			location.has_max_body_size = true;
+		}
+		else if (line.find("stub_status") == 0)
+		{
+			std::vector<std::string> tokens = _tokenize(line);
+			location.stub_status = tokens.size() < 2 || tokens[1] == "on" || tokens[1] == "on;";
+		}
 		else if (line.find("redirect") == 0)
 		{
 			std::vector<std::string> tokens = _split(line, ' ');
@@ -265,29 +431,146 @@ void Config::_parseConfigFile(const std::string& path){
 		throw std::runtime_error("Cannot open config file: " + path);
 	}
 
+	// Strip comments up front so they can't be mistaken for blocks or directives
 	std::string content;
 	std::string line;
 	while (std::getline(file, line)) {
+		size_t comment = line.find('#');
+		if (comment != std::string::npos)
+			line.erase(comment);
 		content += line + "\n";
 	}
 	file.close();
 
-	// Find all server blocks
+	// Top level: server blocks and global directives
 	size_t pos = 0;
-	while ((pos = content.find("server", pos)) != std::string::npos) {
-		size_t block_start = content.find("{", pos);
-		if (block_start == std::string::npos) break;
+	while ((pos = content.find_first_not_of(" \t\r\n", pos)) != std::string::npos) {
+		if (content.compare(pos, 6, "server") == 0 &&
+			(pos + 6 == content.length() || std::isspace(content[pos + 6]) || content[pos + 6] == '{')) {
+			size_t block_start = content.find("{", pos);
+			if (block_start == std::string::npos) break;
+
+			size_t block_end = _findClosingBrace(content, block_start);
+			if (block_end == std::string::npos) break;
+
+			std::string server_block = content.substr(block_start + 1, block_end - block_start - 1);
+			ServerConfig config;
+			_parseServerBlock(server_block, config);
+			_servers.push_back(config);
+
+			pos = block_end + 1;
+		} else {
+			size_t directive_end = content.find(';', pos);
+			if (directive_end == std::string::npos)
+				throw std::runtime_error("Unterminated directive: " + _trim(content.substr(pos)));
+
+			_parseGlobalDirective(_trim(content.substr(pos, directive_end - pos)));
+			pos = directive_end + 1;
+		}
+	}
+
+	if (_output_low_watermark >= _output_high_watermark)
+		throw std::runtime_error("output_low_watermark must be below output_high_watermark");
+}
+
+// Group server blocks by host:port and index their names for Host lookups
+void Config::_buildVirtualHosts() {
+	_endpoints.clear();
+	_vhosts.clear();
+
+	for (size_t i = 0; i < _servers.size(); ++i) {
+		const ServerConfig& server = _servers[i];
+
+		size_t endpoint = _endpoints.size();
+		for (size_t j = 0; j < _endpoints.size(); ++j) {
+			if (_endpoints[j].host == server.host && _endpoints[j].port == server.port) {
+				endpoint = j;
+				break;
+			}
+		}
+		if (endpoint == _endpoints.size()) {
+			ListenEndpoint listen;
+			listen.host = server.host;
+			listen.port = server.port;
+			listen.default_server = i;
+			_endpoints.push_back(listen);
+		}
 
-		size_t block_end = _findClosingBrace(content, block_start);
-		if (block_end == std::string::npos) break;
+		for (size_t j = 0; j < server.server_names.size(); ++j)
+			_vhosts.insert(endpoint, server.server_names[j], i);
+	}
+}
 
-		std::string server_block = content.substr(block_start + 1, block_end - block_start - 1);
-		ServerConfig config;
-		_parseServerBlock(server_block, config);
-		_servers.push_back(config);
+// Process-wide settings that live outside any server block
+void Config::_parseGlobalDirective(const std::string& directive) {
+	std::vector<std::string> tokens = _tokenize(directive);
+	if (tokens.size() < 2)
+		throw std::runtime_error("Invalid directive: " + directive);
 
-		pos = block_end + 1;
+	if (tokens[0] == "event_backend")
+	{
+		if (!Reactor::isSupported(tokens[1]))
+			throw std::runtime_error("Unsupported event backend: " + tokens[1]);
+		_event_backend = tokens[1];
+	}
+	else if (tokens[0] == "worker_threads")
+	{
+		_worker_threads = std::atoi(tokens[1].c_str());
+		if (_worker_threads < 1 || _worker_threads > MAX_WORKER_THREADS)
+			throw std::runtime_error("Invalid worker_threads: " + tokens[1]);
+	}
+	else if (tokens[0] == "worker_processes")
+	{
+		_worker_processes = std::atoi(tokens[1].c_str());
+		if (_worker_processes < 0 || _worker_processes > MAX_WORKER_PROCESSES)
+			throw std::runtime_error("Invalid worker_processes: " + tokens[1]);
+	}
+	else if (tokens[0] == "listen_backlog")
+	{
+		_listen_backlog = std::atoi(tokens[1].c_str());
+		if (_listen_backlog < 1)
+			throw std::runtime_error("Invalid listen_backlog: " + tokens[1]);
+	}
+	else if (tokens[0] == "accept_batch")
+	{
+		_accept_batch = std::atoi(tokens[1].c_str());
+		if (_accept_batch < 1)
+			throw std::runtime_error("Invalid accept_batch: " + tokens[1]);
+	}
+	else if (tokens[0] == "keepalive_requests")
+	{
+		_keepalive_requests = std::atoi(tokens[1].c_str());
+		if (_keepalive_requests < 1)
+			throw std::runtime_error("Invalid keepalive_requests: " + tokens[1]);
+	}
+	else if (tokens[0] == "output_high_watermark")
+		_output_high_watermark = _parseSize(tokens[1]);
+	else if (tokens[0] == "output_low_watermark")
+		_output_low_watermark = _parseSize(tokens[1]);
+	else if (tokens[0] == "file_cache_size")
+		_file_cache_size = _parseSize(tokens[1]);
+	else if (tokens[0] == "file_cache_max_file")
+		_file_cache_max_file = _parseSize(tokens[1]);
+	else if (tokens[0] == "client_header_timeout")
+		_timeouts.header = _parseSeconds(tokens[1]) * 1000;
+	else if (tokens[0] == "client_body_timeout")
+		_timeouts.body = _parseSeconds(tokens[1]) * 1000;
+	else if (tokens[0] == "keepalive_timeout")
+		_timeouts.keepalive = _parseSeconds(tokens[1]) * 1000;
+	else if (tokens[0] == "send_timeout")
+		_timeouts.send = _parseSeconds(tokens[1]) * 1000;
+	else if (tokens[0] == "client_header_deadline")
+		_timeouts.header_deadline = _parseSeconds(tokens[1]) * 1000;
+	else if (tokens[0] == "client_body_min_rate")
+		_timeouts.body_min_rate = _parseSize(tokens[1]);
+	else if (tokens[0] == "client_body_rate_window")
+	{
+		_timeouts.body_rate_window = _parseSeconds(tokens[1]) * 1000;
+		if (_timeouts.body_rate_window == 0)
+			throw std::runtime_error("Invalid client_body_rate_window: " + tokens[1]);
 	}
+	else
+		throw std::runtime_error("Unknown directive: " + tokens[0]);
 }
 
 size_t Config::_findClosingBrace(const std::string& str, size_t start) const
@@ -328,3 +611,52 @@ std::vector<std::string> Config::_split(const std::string& str, char delimiter)
 
 	return tokens;
 }
+
+std::vector<std::string> Config::_tokenize(const std::string& str) const {
+	std::vector<std::string> tokens;
+	std::istringstream stream(str);
+	std::string token;
+
+	while (stream >> token) {
+		tokens.push_back(token);
+	}
+
+	return tokens;
+}
+
+// "30" or "30s"
+unsigned long Config::_parseSeconds(const std::string& value) const {
+	char* end;
+	if (value.empty() || value[0] == '-')
+		throw std::runtime_error("Invalid duration: " + value);
+	unsigned long seconds = std::strtoul(value.c_str(), &end, 10);
+	if (end == value.c_str() || (*end != '\0' && std::string(end) != "s"))
+		throw std::runtime_error("Invalid duration: " + value);
+	return seconds;
+}
+
+// Bytes with an optional k/m/g suffix: "65536", "64k", "1m"
+size_t Config::_parseSize(const std::string& value) const {
+	char* end;
+	if (value.empty() || value[0] == '-')
+		throw std::runtime_error("Invalid size: " + value);
+	errno = 0;
+	unsigned long size = std::strtoul(value.c_str(), &end, 10);
+	if (end == value.c_str() || errno == ERANGE)
+		throw std::runtime_error("Invalid size: " + value);
+
+	unsigned long unit = 1;
+	std::string suffix(end);
+	if (suffix == "k" || suffix == "K")
+		unit = 1024UL;
+	else if (suffix == "m" || suffix == "M")
+		unit = 1024UL * 1024;
+	else if (suffix == "g" || suffix == "G")
+		unit = 1024UL * 1024 * 1024;
+	else if (!suffix.empty())
+		throw std::runtime_error("Invalid size: " + value);
+
+	if (size > static_cast<size_t>(-1) / unit)
+		throw std::runtime_error("Size out of range: " + value);
+	return static_cast<size_t>(size * unit);
+}
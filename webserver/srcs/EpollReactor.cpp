@@ -0,0 +1,85 @@
+#include "EpollReactor.hpp"
+
+#ifdef __linux__
+
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+
+#define EPOLL_INITIAL_EVENTS 256
+#define EPOLL_MAX_EVENTS 65536
+
+static uint32_t toEpollEvents(int events) {
+	uint32_t epoll_events = 0;
+	if (events & EVENT_READ)
+		epoll_events |= EPOLLIN;
+	if (events & EVENT_WRITE)
+		epoll_events |= EPOLLOUT;
+	return epoll_events;
+}
+
+EpollReactor::EpollReactor() : _epoll_fd(-1), _ready(EPOLL_INITIAL_EVENTS) {
+	_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (_epoll_fd < 0)
+		throw std::runtime_error("Failed to create epoll instance");
+}
+
+EpollReactor::~EpollReactor() {
+	if (_epoll_fd != -1)
+		close(_epoll_fd);
+}
+
+bool EpollReactor::add(int fd, int events) {
+	struct epoll_event ev;
+	std::memset(&ev, 0, sizeof(ev));
+	ev.events = toEpollEvents(events);
+	ev.data.fd = fd;
+	if (epoll_ctl(_epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0)
+		return true;
+	if (errno == EEXIST)
+		return modify(fd, events);
+	return false;
+}
+
+bool EpollReactor::modify(int fd, int events) {
+	struct epoll_event ev;
+	std::memset(&ev, 0, sizeof(ev));
+	ev.events = toEpollEvents(events);
+	ev.data.fd = fd;
+	return epoll_ctl(_epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0;
+}
+
+void EpollReactor::remove(int fd) {
+	struct epoll_event ev; // Non-NULL for kernels before 2.6.9
+	std::memset(&ev, 0, sizeof(ev));
+	epoll_ctl(_epoll_fd, EPOLL_CTL_DEL, fd, &ev);
+}
+
+int EpollReactor::wait(std::vector<ReactorEvent>& events, int timeout_ms) {
+	events.clear();
+	int ready = epoll_wait(_epoll_fd, &_ready[0], static_cast<int>(_ready.size()), timeout_ms);
+	if (ready <= 0)
+		return ready;
+
+	for (int i = 0; i < ready; ++i) {
+		uint32_t revents = _ready[i].events;
+		ReactorEvent event;
+		event.fd = _ready[i].data.fd;
+		event.events = 0;
+		if (revents & EPOLLIN)
+			event.events |= EVENT_READ;
+		if (revents & EPOLLOUT)
+			event.events |= EVENT_WRITE;
+		if (revents & (EPOLLERR | EPOLLHUP))
+			event.events |= EVENT_ERROR;
+		events.push_back(event);
+	}
+
+	// A full batch means more fds are probably ready: grow for the next tick
+	if (static_cast<size_t>(ready) == _ready.size() && _ready.size() < EPOLL_MAX_EVENTS)
+		_ready.resize(_ready.size() * 2);
+	return ready;
+}
+
+#endif // __linux__
@@ -0,0 +1,39 @@
+#include "ErrorPages.hpp"
+#include "Config.hpp"
+#include "HttpResponse.hpp"
+
+ErrorPages::ErrorPages(const Config& config) {
+	const std::vector<ServerConfig>& servers = config.getServers();
+	_servers.resize(servers.size());
+
+	for (size_t i = 0; i < servers.size(); ++i) {
+		const std::map<int, std::string>& bodies = servers[i].error_page_bodies;
+		for (std::map<int, std::string>::const_iterator it = bodies.begin(); it != bodies.end(); ++it) {
+			HttpResponse response(it->first);
+			response.setContentType("text/html");
+			response.setBody(it->second);
+
+			std::string head = response.buildHead();
+			head.resize(head.size() - 2); // Blank line goes after the per-response headers
+			std::string body;
+			response.takeBody(body);
+
+			ErrorPage page;
+			page.code = it->first;
+			page.head = SharedBuffer(head);
+			page.body = SharedBuffer(body);
+			_servers[i].push_back(page);
+		}
+	}
+}
+
+const ErrorPage* ErrorPages::find(size_t server, int code) const {
+	if (server >= _servers.size())
+		return NULL;
+	const std::vector<ErrorPage>& pages = _servers[server];
+	for (size_t i = 0; i < pages.size(); ++i) {
+		if (pages[i].code == code)
+			return &pages[i];
+	}
+	return NULL;
+}
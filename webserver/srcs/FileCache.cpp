@@ -0,0 +1,210 @@
+#include "FileCache.hpp"
+#include "HttpResponse.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#define FILE_CACHE_WATCH_EVENTS (IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE \
+	| IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF)
+
+FileCache::FileCache(size_t capacity, size_t max_file)
+	: _notify_fd(-1), _capacity(capacity), _max_file(max_file), _bytes(0),
+	  _hits(0), _misses(0), _evictions(0), _invalidations(0) {
+	// Without inotify nothing would tell us a file changed: no cache then
+	if (_capacity > 0 && _max_file > 0)
+		_notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+}
+
+FileCache::~FileCache() {
+	if (_notify_fd >= 0)
+		close(_notify_fd);
+}
+
+//
+/* Lookup and insertion */
+//
+
+// Location root + request path, with one slash between them
+static std::string cacheKey(const std::string& root, const std::string& uri) {
+	size_t length = root.size();
+	while (length > 0 && root[length - 1] == '/')
+		length--;
+	return root.substr(0, length) + uri;
+}
+
+const CachedFile* FileCache::find(const std::string& root, const std::string& uri) {
+	std::string key = cacheKey(root, uri);
+	std::map<std::string, EntryList::iterator>::iterator found = _index.find(key);
+	if (found == _index.end()) {
+		_misses++;
+		return NULL;
+	}
+	_hits++;
+	_entries.splice(_entries.begin(), _entries, found->second);
+	return &_entries.front();
+}
+
+static bool sameFile(const struct stat& a, const struct stat& b) {
+	return a.st_dev == b.st_dev && a.st_ino == b.st_ino && a.st_size == b.st_size
+		&& a.st_mtime == b.st_mtime;
+}
+
+void FileCache::insert(const std::string& root, const std::string& uri, const std::string& index_file,
+                       const HttpResponse& response) {
+	if (!enabled() || !response.hasFileBody() || response.getFileLength() > _max_file)
+		return;
+	std::string key = cacheKey(root, uri);
+	if (_index.count(key))
+		return;
+
+	struct stat opened;
+	if (fstat(response.getFile().fd(), &opened) != 0 || static_cast<size_t>(opened.st_size) != response.getFileLength())
+		return;
+
+	// Which file the response came from: key itself, or the index file of
+	// the directory at key. A symlink as the last component is never
+	// cached, since changes to its target wouldn't be seen.
+	std::string path = key;
+	struct stat named;
+	if (fstatat(AT_FDCWD, path.c_str(), &named, AT_SYMLINK_NOFOLLOW) != 0)
+		return;
+	if (S_ISDIR(named.st_mode)) {
+		if (path[path.size() - 1] != '/')
+			path += '/';
+		path += index_file;
+		if (fstatat(AT_FDCWD, path.c_str(), &named, AT_SYMLINK_NOFOLLOW) != 0)
+			return;
+	}
+
+	if (!S_ISREG(named.st_mode))
+		return;
+
+	// Watch every directory from the root down first, then check it is
+	// still the same file and read it, so a change (or a directory on the
+	// way being renamed) can't slip in between unnoticed
+	size_t root_length = key.size() - uri.size();
+	for (size_t slash = path.find('/', root_length); slash != std::string::npos;
+		 slash = path.find('/', slash + 1)) {
+		if (!_watch(path.substr(0, slash)))
+			return;
+	}
+	if (fstatat(AT_FDCWD, path.c_str(), &named, AT_SYMLINK_NOFOLLOW) != 0 || !sameFile(named, opened))
+		return;
+
+	std::string body;
+	body.resize(opened.st_size);
+	size_t done = 0;
+	while (done < body.size()) {
+		ssize_t n = pread(response.getFile().fd(), &body[done], body.size() - done, done);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return;
+		done += n;
+	}
+
+	std::string head = response.buildHead();
+	head.resize(head.size() - 2); // Blank line goes after the per-response headers
+	size_t bytes = head.size() + body.size() + key.size() + path.size() + FILE_CACHE_ENTRY_OVERHEAD;
+	if (bytes > _capacity)
+		return;
+	while (_bytes + bytes > _capacity) {
+		_erase(--_entries.end());
+		_evictions++;
+	}
+
+	CachedFile entry;
+	entry.key = key;
+	entry.path = path;
+	entry.etag = response.getHeader("ETag");
+	entry.bytes = bytes;
+	_entries.push_front(entry);
+	_entries.front().head = SharedBuffer(head);
+	_entries.front().body = SharedBuffer(body);
+	_index[key] = _entries.begin();
+	_bytes += bytes;
+}
+
+void FileCache::_erase(EntryList::iterator entry) {
+	_bytes -= entry->bytes;
+	_index.erase(entry->key);
+	_entries.erase(entry);
+}
+
+//
+/* Invalidation */
+//
+
+bool FileCache::_watch(const std::string& directory) {
+	if (_watched.count(directory))
+		return true;
+	int watch = inotify_add_watch(_notify_fd, directory.empty() ? "/" : directory.c_str(),
+		FILE_CACHE_WATCH_EVENTS);
+	if (watch < 0)
+		return false; // Out of watches (max_user_watches): don't cache here
+	_watches[watch] = directory;
+	_watched[directory] = watch;
+	return true;
+}
+
+// Entries read from path or from anywhere below it
+void FileCache::_invalidate(const std::string& path) {
+	EntryList::iterator it = _entries.begin();
+	while (it != _entries.end()) {
+		EntryList::iterator entry = it++;
+		if (entry->path.compare(0, path.size(), path) == 0
+			&& (entry->path.size() == path.size() || entry->path[path.size()] == '/')) {
+			_erase(entry);
+			_invalidations++;
+		}
+	}
+}
+
+void FileCache::processEvents() {
+	char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	for (;;) {
+		ssize_t length = read(_notify_fd, buffer, sizeof(buffer));
+		if (length < 0 && errno == EINTR)
+			continue;
+		if (length <= 0)
+			return;
+
+		for (ssize_t offset = 0; offset < length; ) {
+			const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(buffer + offset);
+			offset += sizeof(struct inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				// Events were lost: anything may have changed
+				_invalidations += _entries.size();
+				_entries.clear();
+				_index.clear();
+				_bytes = 0;
+				continue;
+			}
+			std::map<int, std::string>::iterator watch = _watches.find(event->wd);
+			if (watch == _watches.end())
+				continue;
+			if (event->mask & IN_IGNORED) {
+				// Directory gone or unmounted; its entries went with IN_DELETE_SELF
+				_watched.erase(watch->second);
+				_watches.erase(watch);
+				continue;
+			}
+			if (event->len > 0) {
+				_invalidate(watch->second + "/" + event->name);
+				continue;
+			}
+			_invalidate(watch->second); // The directory itself
+			if (event->mask & IN_MOVE_SELF) {
+				// The watch would follow it to its new name
+				inotify_rm_watch(_notify_fd, watch->first);
+				_watched.erase(watch->second);
+				_watches.erase(watch);
+			}
+		}
+	}
+}
@@ -0,0 +1,73 @@
+#include "HeaderId.hpp"
+#include <cstring>
+
+static const char* const g_header_names[HEADER_COUNT] = {
+    "host",
+    "content-length",
+    "content-type",
+    "transfer-encoding",
+    "connection",
+    "range",
+    "if-range",
+    "if-none-match",
+    "if-modified-since",
+    "accept-encoding",
+    "expect",
+    "cookie",
+    "user-agent",
+    "accept",
+    "authorization",
+    "referer",
+    "accept-language",
+    "upgrade"
+};
+
+// Perfect hash over the names above (no two land in the same slot):
+//   slot = (length * 14 + lower(first) * 3 + lower(last)) & 31
+// When adding a header, pick new multipliers if it collides; the test
+// program checks every name maps back to its own id.
+#define HEADER_HASH_SLOTS 32
+
+static const unsigned char g_header_slots[HEADER_HASH_SLOTS] = {
+    HEADER_UNKNOWN, HEADER_RANGE, HEADER_COOKIE, HEADER_CONNECTION,
+    HEADER_HOST, HEADER_UNKNOWN, HEADER_UPGRADE, HEADER_AUTHORIZATION,
+    HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_REFERER, HEADER_ACCEPT,
+    HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_IF_MODIFIED_SINCE, HEADER_UNKNOWN,
+    HEADER_IF_RANGE, HEADER_TRANSFER_ENCODING, HEADER_UNKNOWN, HEADER_UNKNOWN,
+    HEADER_UNKNOWN, HEADER_CONTENT_LENGTH, HEADER_CONTENT_TYPE, HEADER_EXPECT,
+    HEADER_UNKNOWN, HEADER_IF_NONE_MATCH, HEADER_ACCEPT_LANGUAGE, HEADER_UNKNOWN,
+    HEADER_ACCEPT_ENCODING, HEADER_UNKNOWN, HEADER_UNKNOWN, HEADER_USER_AGENT
+};
+
+static inline unsigned char toLowerAscii(char c) {
+    return static_cast<unsigned char>((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c);
+}
+
+bool equalsIgnoreCase(const char* a, size_t a_len, const char* b, size_t b_len) {
+    if (a_len != b_len)
+        return false;
+    for (size_t i = 0; i < a_len; ++i) {
+        if (toLowerAscii(a[i]) != toLowerAscii(b[i]))
+            return false;
+    }
+    return true;
+}
+
+HeaderId lookupHeaderId(const char* name, size_t length) {
+    if (length == 0)
+        return HEADER_UNKNOWN;
+    size_t slot = (length * 14 + toLowerAscii(name[0]) * 3 + toLowerAscii(name[length - 1]))
+                  & (HEADER_HASH_SLOTS - 1);
+    HeaderId id = static_cast<HeaderId>(g_header_slots[slot]);
+    if (id == HEADER_UNKNOWN)
+        return HEADER_UNKNOWN;
+    // One comparison confirms it is the header and not a collision
+    const char* known = g_header_names[id];
+    if (!equalsIgnoreCase(name, length, known, std::strlen(known)))
+        return HEADER_UNKNOWN;
+    return id;
+}
+
+const char* headerName(HeaderId id) {
+    return id < HEADER_COUNT ? g_header_names[id] : "";
+}
@@ -1,49 +1,111 @@
 #include "HttpRequest.hpp"
-#include <sstream>
-#include <algorithm>
-#include <cctype>
+#include "Scan.hpp"
+#include "UriPath.hpp"
+#include <cstring>
 
-static std::string trim(const std::string& str) {
-    size_t first = str.find_first_not_of(" \t\r\n");
-    if (first == std::string::npos)
-        return "";
-    size_t last = str.find_last_not_of(" \t\r\n");
-    return str.substr(first, (last - first + 1));
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t';
 }
 
-static std::string toLower(const std::string& str) {
-    std::string lower = str;
-    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
-    return lower;
+// Substring search without building lowercase copies
+static bool containsIgnoreCase(const char* haystack, size_t length, const char* needle) {
+    size_t needle_len = std::strlen(needle);
+    if (needle_len > length)
+        return false;
+    for (size_t i = 0; i + needle_len <= length; ++i) {
+        if (equalsIgnoreCase(haystack + i, needle_len, needle, needle_len))
+            return true;
+    }
+    return false;
+}
+
+// A Transfer-Encoding list of exactly one coding, "chunked". Empty list
+// elements don't count (RFC 9110 5.6.1); anything layered under chunked,
+// like "gzip, chunked", is a coding this server doesn't implement.
+static bool isChunkedOnly(const char* value, size_t length) {
+    size_t codings = 0;
+    bool chunked = false;
+    size_t begin = 0;
+    while (begin <= length) {
+        size_t end = begin;
+        while (end < length && value[end] != ',')
+            end++;
+        size_t next = end + 1;
+        while (begin < end && isSpace(value[begin]))
+            begin++;
+        while (end > begin && isSpace(value[end - 1]))
+            end--;
+        if (end > begin) {
+            codings++;
+            chunked = equalsIgnoreCase(value + begin, end - begin, "chunked", 7);
+        }
+        begin = next;
+    }
+    return codings == 1 && chunked;
+}
+
+// Empty the string, but give back the memory if a large body grew it
+static void clearBuffer(std::string& buffer) {
+    if (buffer.capacity() > RETAIN_BUFFER_SIZE)
+        std::string().swap(buffer);
+    else
+        buffer.clear();
 }
 
 HttpRequest::HttpRequest() 
-    : method(UNKNOWN), state(REQUEST_LINE), bytes_parsed(0), 
-      content_length(0), error_code(0) {
+    : method(UNKNOWN), state(REQUEST_LINE), bytes_parsed(0), scan_offset(0),
+      content_length(0), chunked(false), body_received(0),
+      max_body_size(static_cast<size_t>(-1)), body_limit_set(false),
+      defer_body(false), expect_continue(false), error_code(0) {
+    for (size_t i = 0; i < HEADER_COUNT; ++i)
+        known_headers[i].name_length = 0;
 }
 
-void HttpRequest::reset() {
+// Forget the parsed request; raw_data is left to the caller
+void HttpRequest::clearParsed() {
     method = UNKNOWN;
     uri.clear();
     query_string.clear();
     http_version.clear();
-    headers.clear();
-    body.clear();
+    for (size_t i = 0; i < HEADER_COUNT; ++i)
+        known_headers[i].name_length = 0;
+    other_headers.clear();
+    body.reset();
     state = REQUEST_LINE;
-    raw_data.clear();
     bytes_parsed = 0;
+    scan_offset = 0;
     content_length = 0;
+    chunked = false;
+    body_received = 0;
+    max_body_size = static_cast<size_t>(-1);
+    body_limit_set = false;
+    expect_continue = false;
     boundary.clear();
     error_code = 0;
 }
 
-HttpMethod HttpRequest::stringToMethod(const std::string& method_str) {
-    if (method_str == "GET") return GET;
-    if (method_str == "POST") return POST;
-    if (method_str == "DELETE") return DELETE;
-    if (method_str == "PUT") return PUT;
-    if (method_str == "HEAD") return HEAD;
-    return UNKNOWN;
+void HttpRequest::reset() {
+    clearParsed();
+    clearBuffer(raw_data);
+}
+
+void HttpRequest::startNext() {
+    size_t consumed = bytes_parsed;
+    clearParsed();
+
+    if (consumed >= raw_data.size()) {
+        clearBuffer(raw_data);
+        return;
+    }
+    raw_data.erase(0, consumed);
+    if (raw_data.capacity() > RETAIN_BUFFER_SIZE && raw_data.size() <= RETAIN_BUFFER_SIZE)
+        std::string(raw_data).swap(raw_data);
+    parseBuffered();
+}
+
+void HttpRequest::fail(int code) {
+    error_code = code;
+    state = ERROR;
 }
 
 std::string HttpRequest::getMethodString() const {
@@ -57,149 +119,330 @@ std::string HttpRequest::getMethodString() const {
     }
 }
 
-void HttpRequest::parseRequestLine(const std::string& line) {
-    std::istringstream iss(line);
-    std::string method_str;
-    
-    iss >> method_str >> uri >> http_version;
-    
-    method = stringToMethod(method_str);
-    
-    if (method == UNKNOWN) {
-        error_code = 405; // Method Not Allowed
-        state = ERROR;
-        return;
+static HttpMethod methodFromToken(const char* token, size_t length) {
+    switch (length) {
+        case 3:
+            if (std::memcmp(token, "GET", 3) == 0) return GET;
+            if (std::memcmp(token, "PUT", 3) == 0) return PUT;
+            break;
+        case 4:
+            if (std::memcmp(token, "POST", 4) == 0) return POST;
+            if (std::memcmp(token, "HEAD", 4) == 0) return HEAD;
+            break;
+        case 6:
+            if (std::memcmp(token, "DELETE", 6) == 0) return DELETE;
+            break;
     }
-    
-    if (uri.empty() || http_version.empty()) {
-        error_code = 400; // Bad Request
-        state = ERROR;
-        return;
+    return UNKNOWN;
+}
+
+// "METHOD target HTTP/x.y", fields separated by runs of spaces or tabs
+void HttpRequest::parseRequestLine(size_t start, size_t length) {
+    const char* p = raw_data.data() + start;
+    const char* end = p + length;
+    const char* fields[3];
+    size_t lengths[3];
+    int count = 0;
+
+    while (count < 3) {
+        while (p < end && isSpace(*p))
+            p++;
+        if (p == end)
+            break;
+        fields[count] = p;
+        while (p < end && !isSpace(*p))
+            p++;
+        lengths[count] = p - fields[count];
+        count++;
     }
-    
-    // Check HTTP version
-    if (http_version != "HTTP/1.1" && http_version != "HTTP/1.0") {
-        error_code = 505; // HTTP Version Not Supported
-        state = ERROR;
-        return;
+
+    method = count > 0 ? methodFromToken(fields[0], lengths[0]) : UNKNOWN;
+    if (method == UNKNOWN)
+        return fail(405); // Method Not Allowed
+    if (count < 3)
+        return fail(400); // Bad Request
+
+    if (lengths[2] != 8 || (std::memcmp(fields[2], "HTTP/1.1", 8) != 0 &&
+                            std::memcmp(fields[2], "HTTP/1.0", 8) != 0))
+        return fail(505); // HTTP Version Not Supported
+    http_version.assign(fields[2], 8);
+
+    // Absolute-form ("http://host/path") is reduced to its path
+    const char* target = fields[1];
+    const char* target_end = fields[1] + lengths[1];
+    if (lengths[1] > 7 && std::memcmp(target, "http://", 7) == 0) {
+        target = static_cast<const char*>(std::memchr(target + 7, '/', lengths[1] - 7));
+        if (!target) {
+            target = "/";
+            target_end = target + 1;
+        }
     }
-    
-    parseQueryString();
+
+    // Split off the query string, then decode and normalize the path
+    const char* query = static_cast<const char*>(std::memchr(target, '?', target_end - target));
+    if (query)
+        query_string.assign(query + 1, target_end - query - 1);
+    else
+        query = target_end;
+    if (!normalizeUriPath(target, query - target, uri))
+        return fail(400); // Bad Request
     state = HEADERS;
 }
 
-void HttpRequest::parseQueryString() {
-    size_t pos = uri.find('?');
-    if (pos != std::string::npos) {
-        query_string = uri.substr(pos + 1);
-        uri = uri.substr(0, pos);
+void HttpRequest::parseHeader(size_t start, size_t length) {
+    const char* line = raw_data.data() + start;
+    const char* colon = scanChar(line, line + length, ':');
+    if (!colon)
+        return fail(400); // Bad Request
+
+    // Trim whitespace around the name and the value
+    size_t name_begin = 0;
+    size_t name_end = colon - line;
+    while (name_begin < name_end && isSpace(line[name_begin]))
+        name_begin++;
+    while (name_end > name_begin && isSpace(line[name_end - 1]))
+        name_end--;
+    size_t value_begin = colon - line + 1;
+    size_t value_end = length;
+    while (value_begin < value_end && isSpace(line[value_begin]))
+        value_begin++;
+    while (value_end > value_begin && isSpace(line[value_end - 1]))
+        value_end--;
+
+    HeaderField field;
+    field.name = start + name_begin;
+    field.name_length = name_end - name_begin;
+    field.value = start + value_begin;
+    field.value_length = value_end - value_begin;
+
+    HeaderId id = lookupHeaderId(line + name_begin, field.name_length);
+    if (id == HEADER_UNKNOWN) {
+        other_headers.push_back(field);
+        return;
     }
+    // Two Hosts or two lengths make the request ambiguous (RFC 7230 5.4, 3.3.2)
+    if (known_headers[id].name_length != 0 && (id == HEADER_HOST || id == HEADER_CONTENT_LENGTH))
+        return fail(400);
+    // A repeated Transfer-Encoding adds codings to the list
+    if (known_headers[id].name_length != 0 && id == HEADER_TRANSFER_ENCODING)
+        return fail(501);
+    known_headers[id] = field; // Otherwise the last one wins
 }
 
-void HttpRequest::parseHeader(const std::string& line) {
-    size_t pos = line.find(':');
-    if (pos == std::string::npos) {
-        error_code = 400; // Bad Request
-        state = ERROR;
-        return;
+bool HttpRequest::findHeader(HeaderId id, const char*& value, size_t& length) const {
+    if (id >= HEADER_COUNT || known_headers[id].name_length == 0)
+        return false;
+    value = raw_data.data() + known_headers[id].value;
+    length = known_headers[id].value_length;
+    return true;
+}
+
+// Later headers win, as repeated map assignment used to behave
+bool HttpRequest::findHeader(const char* name, const char*& value, size_t& length) const {
+    size_t name_len = std::strlen(name);
+    HeaderId id = lookupHeaderId(name, name_len);
+    if (id != HEADER_UNKNOWN)
+        return findHeader(id, value, length);
+
+    const char* buffer = raw_data.data();
+    for (size_t i = other_headers.size(); i-- > 0; ) {
+        const HeaderField& field = other_headers[i];
+        if (equalsIgnoreCase(buffer + field.name, field.name_length, name, name_len)) {
+            value = buffer + field.value;
+            length = field.value_length;
+            return true;
+        }
     }
-    
-    std::string key = trim(line.substr(0, pos));
-    std::string value = trim(line.substr(pos + 1));
-    
-    // Convert header names to lowercase for case-insensitive lookup
-    headers[toLower(key)] = value;
+    return false;
 }
 
 std::string HttpRequest::getHeader(const std::string& key) const {
-    std::string lower_key = toLower(key);
-    std::map<std::string, std::string>::const_iterator it = headers.find(lower_key);
-    if (it != headers.end())
-        return it->second;
+    const char* value;
+    size_t length;
+    if (findHeader(key.c_str(), value, length))
+        return std::string(value, length);
     return "";
 }
 
-bool HttpRequest::isChunked() const {
-    std::string transfer_encoding = getHeader("Transfer-Encoding");
-    return toLower(transfer_encoding).find("chunked") != std::string::npos;
+bool HttpRequest::headerContains(HeaderId id, const char* token) const {
+    const char* value;
+    size_t length;
+    return findHeader(id, value, length) && containsIgnoreCase(value, length, token);
 }
 
-bool HttpRequest::parse(const char* data, size_t len) {
-    if (state == COMPLETE || state == ERROR)
-        return state == COMPLETE;
-    
-    raw_data.append(data, len);
+bool HttpRequest::headerContains(const char* name, const char* token) const {
+    const char* value;
+    size_t length;
+    return findHeader(name, value, length) && containsIgnoreCase(value, length, token);
+}
+
+size_t HttpRequest::getHeaderCount() const {
+    size_t count = other_headers.size();
+    for (size_t i = 0; i < HEADER_COUNT; ++i) {
+        if (known_headers[i].name_length != 0)
+            count++;
+    }
+    return count;
+}
+
+// HTTP/1.1 is persistent unless "Connection: close"; HTTP/1.0 only with
+// "Connection: keep-alive"
+bool HttpRequest::keepAlive() const {
+    if (http_version == "HTTP/1.0")
+        return headerContains(HEADER_CONNECTION, "keep-alive");
+    return !headerContains(HEADER_CONNECTION, "close");
+}
+
+// Blank line seen: work out how the body is framed
+void HttpRequest::finishHeaders() {
+    const char* value;
+    size_t length;
+
+    if (findHeader(HEADER_CONTENT_LENGTH, value, length)) {
+        if (length == 0)
+            return fail(400);
+        content_length = 0;
+        for (size_t i = 0; i < length; ++i) {
+            if (value[i] < '0' || value[i] > '9')
+                return fail(400);
+            size_t digit = value[i] - '0';
+            if (content_length > (static_cast<size_t>(-1) - digit) / 10)
+                return fail(413); // Payload Too Large
+            content_length = content_length * 10 + digit;
+        }
+    }
     
-    while (state != COMPLETE && state != ERROR) {
-        if (state == REQUEST_LINE || state == HEADERS) {
-            size_t line_end = raw_data.find("\r\n", bytes_parsed);
-            if (line_end == std::string::npos) {
-                // Check for request line/header size limits
-                if (raw_data.size() > 8192) { // 8KB limit for headers
-                    error_code = 431; // Request Header Fields Too Large
-                    state = ERROR;
-                }
-                return false; // Need more data
-            }
-            
-            std::string line = raw_data.substr(bytes_parsed, line_end - bytes_parsed);
-            bytes_parsed = line_end + 2; // Skip \r\n
-            
-            if (state == REQUEST_LINE) {
-                parseRequestLine(line);
-            } else if (state == HEADERS) {
-                if (line.empty()) {
-                    // Empty line marks end of headers
-                    std::string content_len_str = getHeader("Content-Length");
-                    if (!content_len_str.empty()) {
-                        std::istringstream iss(content_len_str);
-                        iss >> content_length;
-                    }
-                    
-                    // Extract boundary for multipart/form-data
-                    std::string content_type = getHeader("Content-Type");
-                    if (content_type.find("multipart/form-data") != std::string::npos) {
-                        size_t boundary_pos = content_type.find("boundary=");
-                        if (boundary_pos != std::string::npos) {
-                            boundary = content_type.substr(boundary_pos + 9);
-                            // Remove quotes if present (C++98 compatible)
-                            if (!boundary.empty() && boundary[0] == '"' && 
-                                boundary[boundary.length() - 1] == '"') {
-                                boundary = boundary.substr(1, boundary.length() - 2);
-                            }
-                        }
-                    }
-                    
-                    if (content_length > 0 || isChunked()) {
-                        state = BODY;
-                    } else {
-                        state = COMPLETE;
-                    }
-                } else {
-                    parseHeader(line);
-                }
-            }
-        } else if (state == BODY) {
-            if (isChunked()) {
-                // Simplified chunked handling - in real implementation, 
-                // you'd need to properly parse chunk sizes
-                error_code = 501; // Not Implemented for chunked
-                state = ERROR;
-                return false;
-            } else {
-                // Read based on Content-Length
-                size_t available = raw_data.size() - bytes_parsed;
-                if (available >= content_length) {
-                    body = raw_data.substr(bytes_parsed, content_length);
-                    bytes_parsed += content_length;
-                    state = COMPLETE;
-                } else {
-                    // Need more data
-                    return false;
+    // Extract boundary for multipart/form-data
+    if (findHeader(HEADER_CONTENT_TYPE, value, length) &&
+        containsIgnoreCase(value, length, "multipart/form-data")) {
+        const char* end = value + length;
+        for (const char* p = value; p + 9 <= end; ++p) {
+            if (equalsIgnoreCase(p, 9, "boundary=", 9)) {
+                boundary.assign(p + 9, end - p - 9);
+                // Remove quotes if present
+                if (boundary.length() >= 2 && boundary[0] == '"' &&
+                    boundary[boundary.length() - 1] == '"') {
+                    boundary = boundary.substr(1, boundary.length() - 2);
                 }
+                break;
             }
         }
     }
+
+    if (findHeader(HEADER_TRANSFER_ENCODING, value, length)) {
+        if (!isChunkedOnly(value, length))
+            return fail(501); // Only chunked is implemented
+        // Both framings at once is a request smuggling vector
+        if (findHeader(HEADER_CONTENT_LENGTH, value, length))
+            return fail(400);
+        chunked = true;
+        decoder.reset(max_body_size);
+    }
+
+    // HTTP/1.0 clients can't know the expectation mechanism (RFC 7231 5.1.1)
+    if (findHeader(HEADER_EXPECT, value, length) && http_version == "HTTP/1.1") {
+        if (!equalsIgnoreCase(value, length, "100-continue", 12))
+            return fail(417); // Expectation Failed
+        expect_continue = true;
+    }
+
+    if (content_length > 0 || chunked) {
+        state = BODY;
+    } else {
+        state = COMPLETE;
+    }
+}
+
+void HttpRequest::setBodyLimit(size_t limit, size_t buffer_size) {
+    max_body_size = limit;
+    body.setBufferSize(buffer_size);
+    body_limit_set = true;
+    if (state != BODY)
+        return;
+    if (content_length > limit)
+        return fail(413); // Payload Too Large
+    if (chunked)
+        decoder.reset(limit);
+    parseBuffered();
+}
+
+// Hand whatever body bytes have arrived to the body, then drop them from
+// the receive buffer. bytes_parsed stays at the start of the body, so
+// startNext() still finds any pipelined bytes right after it.
+bool HttpRequest::parseBody() {
+    const char* data = raw_data.data() + bytes_parsed;
+    size_t available = raw_data.size() - bytes_parsed;
+    size_t used;
+
+    if (chunked) {
+        used = decoder.feed(data, available, body);
+        body_received = decoder.getDecodedSize();
+        if (decoder.hasFailed()) {
+            fail(decoder.getErrorCode());
+            return false;
+        }
+        if (decoder.isDone())
+            state = COMPLETE;
+    } else {
+        used = content_length - body_received;
+        if (used > available)
+            used = available;
+        if (!body.write(data, used)) {
+            fail(500); // Couldn't spool the body
+            return false;
+        }
+        body_received += used;
+        if (body_received == content_length)
+            state = COMPLETE;
+    }
+    raw_data.erase(bytes_parsed, used);
+    return state == COMPLETE;
+}
+
+bool HttpRequest::parse(const char* data, size_t len) {
+    if (state == ERROR)
+        return false;
+
+    raw_data.append(data, len);
+    if (state == COMPLETE)
+        return true; // Already the start of the next request, see startNext()
+    return parseBuffered();
+}
+
+bool HttpRequest::parseBuffered() {
+    while (state == REQUEST_LINE || state == HEADERS) {
+        const char* buffer = raw_data.data();
+        const char* newline = scanChar(buffer + scan_offset, buffer + raw_data.size(), '\n');
+        if (!newline) {
+            // Don't rescan these bytes when more arrive
+            scan_offset = raw_data.size();
+            if (raw_data.size() > MAX_HEADER_SIZE)
+                fail(431); // Request Header Fields Too Large
+            return false; // Need more data
+        }
+
+        size_t line = bytes_parsed;
+        size_t line_end = newline - buffer;
+        bytes_parsed = scan_offset = line_end + 1;
+        if (line_end > line && buffer[line_end - 1] == '\r')
+            line_end--; // CRLF, or a bare LF
+
+        if (state == REQUEST_LINE) {
+            // Tolerate empty lines before the request line (RFC 7230 3.5)
+            if (line_end != line)
+                parseRequestLine(line, line_end - line);
+        } else if (line_end == line) {
+            // Empty line marks end of headers
+            finishHeaders();
+        } else {
+            parseHeader(line, line_end - line);
+        }
+        if (state == HEADERS && bytes_parsed > MAX_HEADER_SIZE)
+            fail(431);
+    }
+
+    if (state == BODY && !needsBodyLimit())
+        return parseBody();
     
     return state == COMPLETE;
 }
@@ -1,93 +1,264 @@
 #include "HttpResponse.hpp"
-#include <sstream>
-#include <fstream>
-
-std::string HttpResponse::loadErrorPage(const std::string& error_code) {
-    std::string file_path = "www/errors/" + error_code + ".html";
-    std::ifstream file(file_path.c_str());
-    
-    if (file.is_open()) {
-        std::stringstream buffer;
-        buffer << file.rdbuf();
-        file.close();
-        return buffer.str();
+#include <cctype>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+// Sorted by code for findStatus()
+#define STATUS_LINE(code, text) \
+    { code, text, "HTTP/1.1 " #code " " text "\r\n", sizeof("HTTP/1.1 " #code " " text "\r\n") - 1 }
+
+static const StatusLine g_status_lines[] = {
+    STATUS_LINE(200, "OK"),
+    STATUS_LINE(201, "Created"),
+    STATUS_LINE(204, "No Content"),
+    STATUS_LINE(301, "Moved Permanently"),
+    STATUS_LINE(302, "Found"),
+    STATUS_LINE(304, "Not Modified"),
+    STATUS_LINE(400, "Bad Request"),
+    STATUS_LINE(403, "Forbidden"),
+    STATUS_LINE(404, "Not Found"),
+    STATUS_LINE(405, "Method Not Allowed"),
+    STATUS_LINE(413, "Payload Too Large"),
+    STATUS_LINE(417, "Expectation Failed"),
+    STATUS_LINE(431, "Request Header Fields Too Large"),
+    STATUS_LINE(500, "Internal Server Error"),
+    STATUS_LINE(501, "Not Implemented"),
+    STATUS_LINE(505, "HTTP Version Not Supported"),
+};
+
+#define STATUS_LINE_COUNT (sizeof(g_status_lines) / sizeof(g_status_lines[0]))
+
+// Writes value in decimal ending at end, returns where it starts
+static char* formatDecimal(size_t value, char* end) {
+    do {
+        *--end = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value);
+    return end;
+}
+
+static bool sameName(const ArenaString& a, const char* b, size_t length) {
+    if (a.size() != length)
+        return false;
+    for (size_t i = 0; i < length; ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+            return false;
     }
-    
-    // Fallback to generic error response if file not found
-    return "<html><body><h1>" + error_code + " Error</h1></body></html>";
+    return true;
 }
 
 HttpResponse::HttpResponse() 
-    : status_code(200), status_message("OK"), headers_sent(false) {
-    setHeader("Server", "WebServ/1.0");
+    : status_code(200), status(findStatus(200)), file_length(0), headers_sent(false) {
+    headers.reserve(RESPONSE_HEADERS_RESERVE);
+    setHeader("Server", 6, "WebServ/1.0", 11);
 }
 
 HttpResponse::HttpResponse(int code) 
-    : status_code(code), headers_sent(false) {
-    status_message = getStatusMessage(code);
-    setHeader("Server", "WebServ/1.0");
-}
-
-std::string HttpResponse::getStatusMessage(int code) const {
-    switch (code) {
-        case 200: return "OK";
-        case 201: return "Created";
-        case 204: return "No Content";
-        case 301: return "Moved Permanently";
-        case 302: return "Found";
-        case 304: return "Not Modified";
-        case 400: return "Bad Request";
-        case 403: return "Forbidden";
-        case 404: return "Not Found";
-        case 405: return "Method Not Allowed";
-        case 413: return "Payload Too Large";
-        case 431: return "Request Header Fields Too Large";
-        case 500: return "Internal Server Error";
-        case 501: return "Not Implemented";
-        case 505: return "HTTP Version Not Supported";
-        default: return "Unknown";
+    : status_code(code), status(findStatus(code)), file_length(0), headers_sent(false) {
+    headers.reserve(RESPONSE_HEADERS_RESERVE);
+    setHeader("Server", 6, "WebServ/1.0", 11);
+}
+
+const StatusLine* HttpResponse::findStatus(int code) {
+    size_t low = 0;
+    size_t high = STATUS_LINE_COUNT;
+    while (low < high) {
+        size_t middle = (low + high) / 2;
+        if (g_status_lines[middle].code < code)
+            low = middle + 1;
+        else
+            high = middle;
     }
+    if (low < STATUS_LINE_COUNT && g_status_lines[low].code == code)
+        return &g_status_lines[low];
+    return NULL;
+}
+
+const char* HttpResponse::getStatusMessage(int code) {
+    const StatusLine* line = findStatus(code);
+    return line ? line->text : "Unknown";
 }
 
 void HttpResponse::setStatusCode(int code) {
     status_code = code;
-    status_message = getStatusMessage(code);
+    status = findStatus(code);
 }
 
 void HttpResponse::setHeader(const std::string& key, const std::string& value) {
-    headers[key] = value;
+    setHeader(key.data(), key.size(), value.data(), value.size());
+}
+
+// Replaces the value of a header already set, keeping its position
+void HttpResponse::setHeader(const char* key, size_t key_length, const char* value, size_t value_length) {
+    for (ArenaHeaderList::iterator it = headers.begin(); it != headers.end(); ++it) {
+        if (sameName(it->name, key, key_length)) {
+            it->value.assign(value, value_length);
+            return;
+        }
+    }
+    headers.push_back(HeaderLine());
+    headers.back().name.assign(key, key_length);
+    headers.back().value.assign(value, value_length);
+}
+
+std::string HttpResponse::getHeader(const std::string& key) const {
+    for (ArenaHeaderList::const_iterator it = headers.begin(); it != headers.end(); ++it) {
+        if (sameName(it->name, key.data(), key.size()))
+            return std::string(it->value.data(), it->value.size());
+    }
+    return "";
 }
 
 void HttpResponse::setBody(const std::string& content) {
-    body = content;
-    std::ostringstream oss;
-    oss << content.size();
-    setHeader("Content-Length", oss.str());
+    std::string copy(content);
+    adoptBody(copy);
+}
+
+void HttpResponse::adoptBody(std::string& content) {
+    body.swap(content);
+    content.clear();
+    file = SharedFile();
+    file_length = 0;
+    setContentLength(body.size());
+}
+
+void HttpResponse::setFileBody(const SharedFile& body_file, size_t length) {
+    body.clear();
+    file = body_file;
+    file_length = length;
+    setContentLength(length);
+}
+
+void HttpResponse::setContentLength(size_t length) {
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    char* start = formatDecimal(length, end);
+    setHeader("Content-Length", 14, start, end - start);
 }
 
 void HttpResponse::setContentType(const std::string& mime_type) {
     setHeader("Content-Type", mime_type);
 }
 
+std::string HttpResponse::httpDate(time_t when) {
+    struct tm utc;
+    char date[64];
+    gmtime_r(&when, &utc);
+    return std::string(date, strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &utc));
+}
+
+std::string HttpResponse::entityTag(time_t mtime, size_t size) {
+    static const char digits[] = "0123456789abcdef";
+    char tag[48];
+    char* end = tag + sizeof(tag);
+    char* p = end;
+    *--p = '"';
+    do {
+        *--p = digits[size & 15];
+        size >>= 4;
+    } while (size);
+    *--p = '-';
+    unsigned long seconds = mtime < 0 ? 0 : static_cast<unsigned long>(mtime);
+    do {
+        *--p = digits[seconds & 15];
+        seconds >>= 4;
+    } while (seconds);
+    *--p = '"';
+    return std::string(p, end);
+}
+
+// Tags are walked one by one rather than split on commas, which may
+// appear inside a quoted tag. A malformed element ends the match.
+bool HttpResponse::matchesEntityTag(const char* list, size_t length, const std::string& etag) {
+    if (length == 1 && list[0] == '*')
+        return true;
+    size_t skip = etag.compare(0, 2, "W/") == 0 ? 2 : 0;
+    const char* opaque = etag.data() + skip;
+    size_t opaque_length = etag.length() - skip;
+    if (opaque_length == 0)
+        return false;
+
+    size_t i = 0;
+    while (i < length) {
+        if (list[i] == ',' || list[i] == ' ' || list[i] == '\t') {
+            i++;
+            continue;
+        }
+        if (length - i >= 2 && list[i] == 'W' && list[i + 1] == '/')
+            i += 2;
+        if (i == length || list[i] != '"')
+            return false;
+        const char* close = static_cast<const char*>(std::memchr(list + i + 1, '"', length - i - 1));
+        if (!close)
+            return false;
+        size_t tag_length = close + 1 - (list + i);
+        if (tag_length == opaque_length && std::memcmp(list + i, opaque, tag_length) == 0)
+            return true;
+        i += tag_length;
+    }
+    return false;
+}
+
 std::string HttpResponse::build() {
-    std::ostringstream response;
-    
-    // Status line
-    response << "HTTP/1.1 " << status_code << " " << status_message << "\r\n";
-    
-    // Headers
-    for (std::map<std::string, std::string>::const_iterator it = headers.begin();
-         it != headers.end(); ++it) {
-        response << it->first << ": " << it->second << "\r\n";
+    std::string response = buildHead();
+    if (!file.valid())
+        return response + body;
+
+    size_t start = response.size();
+    response.resize(start + file_length);
+    size_t done = 0;
+    while (done < file_length) {
+        ssize_t n = pread(file.fd(), &response[start + done], file_length - done, done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            break;
+        done += n;
+    }
+    response.resize(start + done);
+    return response;
+}
+
+std::string HttpResponse::buildHead() const {
+    char unknown[48]; // Status line for a code outside the table
+    const char* line;
+    size_t line_length;
+    if (status) {
+        line = status->line;
+        line_length = status->length;
+    } else {
+        char* end = unknown + sizeof(unknown);
+        static const char suffix[] = " Unknown\r\n";
+        char* p = end - (sizeof(suffix) - 1);
+        std::memcpy(p, suffix, sizeof(suffix) - 1);
+        p = formatDecimal(status_code < 0 ? 0 : status_code, p);
+        p -= 9;
+        std::memcpy(p, "HTTP/1.1 ", 9);
+        line = p;
+        line_length = end - p;
+    }
+
+    size_t size = line_length + 2;
+    for (ArenaHeaderList::const_iterator it = headers.begin(); it != headers.end(); ++it)
+        size += it->name.size() + 2 + it->value.size() + 2;
+
+    std::string head;
+    head.reserve(size);
+    head.append(line, line_length);
+    for (ArenaHeaderList::const_iterator it = headers.begin(); it != headers.end(); ++it) {
+        head.append(it->name.data(), it->name.size());
+        head.append(": ", 2);
+        head.append(it->value.data(), it->value.size());
+        head.append("\r\n", 2);
     }
-    
-    // Empty line separating headers from body
-    response << "\r\n";
-    
-    // Body
-    response << body;
-    
-    return response.str();
+    head.append("\r\n", 2);
+    return head;
+}
+
+void HttpResponse::takeBody(std::string& out) {
+    out.swap(body);
+    body.clear();
 }
 
 // Static helper methods
@@ -102,8 +273,8 @@ HttpResponse HttpResponse::created(const std::string& location) {
     HttpResponse response(201);
     if (!location.empty())
         response.setHeader("Location", location);
-    response.setBody("<html><body><h1>201 Created</h1></body></html>");
     response.setContentType("text/html");
+    response.setBody("<html><body><h1>201 Created</h1></body></html>");
     return response;
 }
 
@@ -117,61 +288,69 @@ HttpResponse HttpResponse::redirect(const std::string& location, int code) {
     response.setHeader("Location", location);
     std::string body = "<html><body><h1>Redirect</h1><p>Redirecting to <a href=\"" + 
                        location + "\">" + location + "</a></p></body></html>";
-    response.setBody(body);
     response.setContentType("text/html");
+    response.adoptBody(body);
     return response;
 }
 
 HttpResponse HttpResponse::badRequest(const std::string& message) {
     HttpResponse response(400);
     std::string body = "<html><body><h1>400 Bad Request</h1><p>" + message + "</p></body></html>";
-    response.setBody(body);
     response.setContentType("text/html");
+    response.adoptBody(body);
     return response;
 }
 
 HttpResponse HttpResponse::notFound(const std::string& message) {
     HttpResponse response(404);
-    std::string body = loadErrorPage("404");
-    if (body == "<html><body><h1>404 Error</h1></body></html>") {
-        body = "<html><body><h1>404 Not Found</h1><p>" + message + "</p></body></html>";
-    }
-    response.setBody(body);
+    std::string body = "<html><body><h1>404 Not Found</h1><p>" + message + "</p></body></html>";
     response.setContentType("text/html");
+    response.adoptBody(body);
     return response;
 }
 
 HttpResponse HttpResponse::methodNotAllowed(const std::string& message) {
     HttpResponse response(405);
     std::string body = "<html><body><h1>405 Method Not Allowed</h1><p>" + message + "</p></body></html>";
-    response.setBody(body);
     response.setContentType("text/html");
+    response.adoptBody(body);
     return response;
 }
 
 HttpResponse HttpResponse::internalServerError(const std::string& message) {
     HttpResponse response(500);
-    std::string body = loadErrorPage("500");
-    if (body == "<html><body><h1>500 Error</h1></body></html>") {
-        body = "<html><body><h1>500 Internal Server Error</h1><p>" + message + "</p></body></html>";
-    }
-    response.setBody(body);
+    std::string body = "<html><body><h1>500 Internal Server Error</h1><p>" + message + "</p></body></html>";
     response.setContentType("text/html");
+    response.adoptBody(body);
     return response;
 }
 
 HttpResponse HttpResponse::notImplemented(const std::string& message) {
     HttpResponse response(501);
     std::string body = "<html><body><h1>501 Not Implemented</h1><p>" + message + "</p></body></html>";
-    response.setBody(body);
     response.setContentType("text/html");
+    response.adoptBody(body);
     return response;
 }
 
 HttpResponse HttpResponse::payloadTooLarge(const std::string& message) {
     HttpResponse response(413);
     std::string body = "<html><body><h1>413 Payload Too Large</h1><p>" + message + "</p></body></html>";
-    response.setBody(body);
     response.setContentType("text/html");
+    response.adoptBody(body);
+    return response;
+}
+
+HttpResponse HttpResponse::error(int code) {
+    HttpResponse response(code);
+    char digits[24];
+    char* end = digits + sizeof(digits);
+    std::string body = "<html><body><h1>";
+    body.append(formatDecimal(code < 0 ? 0 : code, end), end);
+    body += " ";
+    body += getStatusMessage(code);
+    body += "</h1></body></html>";
+    response.setContentType("text/html");
+    response.adoptBody(body);
     return response;
 }
@@ -0,0 +1,210 @@
+#include "OutputQueue.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+
+//
+/* SharedBuffer */
+//
+
+SharedBuffer::SharedBuffer() : _block(NULL) {}
+
+SharedBuffer::SharedBuffer(std::string& data) : _block(new Block()) {
+	_block->refs = 1;
+	_block->data.swap(data);
+}
+
+SharedBuffer::SharedBuffer(const SharedBuffer& other) : _block(other._block) {
+	if (_block)
+		_block->refs++;
+}
+
+SharedBuffer& SharedBuffer::operator=(const SharedBuffer& other) {
+	if (_block != other._block) {
+		_release();
+		_block = other._block;
+		if (_block)
+			_block->refs++;
+	}
+	return *this;
+}
+
+SharedBuffer::~SharedBuffer() {
+	_release();
+}
+
+void SharedBuffer::_release() {
+	if (_block && --_block->refs == 0)
+		delete _block;
+	_block = NULL;
+}
+
+const char* SharedBuffer::data() const {
+	return _block ? _block->data.data() : NULL;
+}
+
+size_t SharedBuffer::size() const {
+	return _block ? _block->data.size() : 0;
+}
+
+//
+/* OutputQueue */
+//
+
+OutputQueue::OutputQueue() : _pending(0) {}
+
+void OutputQueue::push(std::string& data) {
+	if (data.empty())
+		return;
+	SharedBuffer buffer(data);
+	push(buffer, 0, buffer.size());
+}
+
+void OutputQueue::push(const SharedBuffer& buffer, size_t offset, size_t length) {
+	if (length == 0)
+		return;
+	OutputSegment segment;
+	segment.buffer = buffer;
+	segment.offset = offset;
+	segment.length = length;
+	_segments.push_back(segment);
+	_pending += length;
+}
+
+void OutputQueue::push(const SharedFile& file, off_t offset, size_t length) {
+	if (length == 0)
+		return;
+	OutputSegment segment;
+	segment.file = file;
+	segment.offset = static_cast<size_t>(offset);
+	segment.length = length;
+	_segments.push_back(segment);
+	_pending += length;
+}
+
+void OutputQueue::clear() {
+	_segments.clear();
+	_pending = 0;
+}
+
+// The front file region, as far as the socket takes it
+static ssize_t sendFileRegion(int fd, const OutputSegment& segment) {
+	off_t offset = static_cast<off_t>(segment.offset);
+	ssize_t written = sendfile(fd, segment.file.fd(), &offset, segment.length);
+	if (written == 0) {
+		errno = EIO; // Truncated since it was opened
+		return -1;
+	}
+	return written;
+}
+
+// Memory segments up to the next file region in one call
+static ssize_t sendMemory(int fd, const OutputQueue& output) {
+	struct iovec iov[OUTPUT_IOV_MAX];
+	bool file_follows;
+	int count = output.gather(iov, OUTPUT_IOV_MAX, file_follows);
+	if (!file_follows)
+		return writev(fd, iov, count);
+
+	struct msghdr message;
+	std::memset(&message, 0, sizeof(message));
+	message.msg_iov = iov;
+	message.msg_iovlen = count;
+	return sendmsg(fd, &message, MSG_MORE);
+}
+
+ssize_t OutputQueue::flush(int fd) {
+	ssize_t total = 0;
+
+	while (!_segments.empty()) {
+		ssize_t written;
+		if (_segments.front().file.valid())
+			written = sendFileRegion(fd, _segments.front());
+		else
+			written = sendMemory(fd, *this);
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+			return total > 0 ? total : -1;
+		}
+		if (written == 0)
+			break;
+		total += written;
+		if (_advance(written))
+			break; // Socket buffer is full
+	}
+	return total;
+}
+
+int OutputQueue::gather(struct iovec* iov, int max, bool& file_follows) const {
+	int count = 0;
+	file_follows = false;
+
+	for (std::deque<OutputSegment>::const_iterator it = _segments.begin();
+	     it != _segments.end() && count < max; ++it, ++count) {
+		if (it->file.valid()) {
+			file_follows = true;
+			break;
+		}
+		iov[count].iov_base = const_cast<char*>(it->buffer.data() + it->offset);
+		iov[count].iov_len = it->length;
+	}
+	return count;
+}
+
+void OutputQueue::consume(size_t written) {
+	_advance(written);
+}
+
+// Drop whole segments, then advance into the partial one. Returns true if
+// the write ended inside a segment.
+bool OutputQueue::_advance(size_t written) {
+	_pending -= written;
+	while (written > 0 && written >= _segments.front().length) {
+		written -= _segments.front().length;
+		_segments.pop_front();
+	}
+	if (written == 0)
+		return false;
+	_segments.front().offset += written;
+	_segments.front().length -= written;
+	return true;
+}
+
+const OutputSegment* OutputQueue::firstFile(size_t& before) const {
+	before = 0;
+	for (std::deque<OutputSegment>::const_iterator it = _segments.begin(); it != _segments.end(); ++it) {
+		if (it->file.valid())
+			return &*it;
+		before += it->length;
+	}
+	return NULL;
+}
+
+void OutputQueue::fillFile(std::string& data) {
+	std::deque<OutputSegment>::iterator it = _segments.begin();
+	while (it != _segments.end() && !it->file.valid())
+		++it;
+	if (it == _segments.end() || data.empty())
+		return;
+
+	size_t length = data.size() < it->length ? data.size() : it->length;
+	SharedBuffer buffer(data);
+	if (length == it->length) {
+		it->file = SharedFile();
+		it->buffer = buffer;
+		it->offset = 0;
+		return;
+	}
+	it->offset += length;
+	it->length -= length;
+
+	OutputSegment segment;
+	segment.buffer = buffer;
+	segment.offset = 0;
+	segment.length = length;
+	_segments.insert(it, segment);
+}
@@ -0,0 +1,81 @@
+#include "PollReactor.hpp"
+
+static short toPollEvents(int events) {
+	short poll_events = 0;
+	if (events & EVENT_READ)
+		poll_events |= POLLIN;
+	if (events & EVENT_WRITE)
+		poll_events |= POLLOUT;
+	return poll_events;
+}
+
+PollReactor::PollReactor() {}
+
+PollReactor::~PollReactor() {}
+
+bool PollReactor::add(int fd, int events) {
+	if (fd < 0)
+		return false;
+	if (static_cast<size_t>(fd) >= _index.size())
+		_index.resize(fd + 1, -1);
+	if (_index[fd] != -1)
+		return modify(fd, events);
+
+	struct pollfd entry;
+	entry.fd = fd;
+	entry.events = toPollEvents(events);
+	entry.revents = 0;
+	_index[fd] = static_cast<int>(_fds.size());
+	_fds.push_back(entry);
+	return true;
+}
+
+bool PollReactor::modify(int fd, int events) {
+	if (fd < 0 || static_cast<size_t>(fd) >= _index.size() || _index[fd] == -1)
+		return false;
+	_fds[_index[fd]].events = toPollEvents(events);
+	return true;
+}
+
+void PollReactor::remove(int fd) {
+	if (fd < 0 || static_cast<size_t>(fd) >= _index.size() || _index[fd] == -1)
+		return;
+
+	// Keep the array dense: move the last entry into the freed slot
+	size_t slot = _index[fd];
+	size_t last = _fds.size() - 1;
+	if (slot != last) {
+		_fds[slot] = _fds[last];
+		_index[_fds[slot].fd] = static_cast<int>(slot);
+	}
+	_fds.pop_back();
+	_index[fd] = -1;
+}
+
+int PollReactor::wait(std::vector<ReactorEvent>& events, int timeout_ms) {
+	events.clear();
+	if (_fds.empty())
+		return poll(NULL, 0, timeout_ms);
+
+	int ready = poll(&_fds[0], _fds.size(), timeout_ms);
+	if (ready <= 0)
+		return ready;
+
+	for (size_t i = 0; i < _fds.size() && static_cast<int>(events.size()) < ready; ++i) {
+		short revents = _fds[i].revents;
+		if (revents == 0)
+			continue;
+
+		ReactorEvent event;
+		event.fd = _fds[i].fd;
+		event.events = 0;
+		if (revents & POLLIN)
+			event.events |= EVENT_READ;
+		if (revents & POLLOUT)
+			event.events |= EVENT_WRITE;
+		if (revents & (POLLERR | POLLHUP | POLLNVAL))
+			event.events |= EVENT_ERROR;
+		events.push_back(event);
+	}
+	return static_cast<int>(events.size());
+}
@@ -0,0 +1,45 @@
+#include "Reactor.hpp"
+#include "PollReactor.hpp"
+#include "EpollReactor.hpp"
+#include "UringReactor.hpp"
+
+#include <iostream>
+#include <stdexcept>
+
+bool Reactor::isSupported(const std::string& backend) {
+	if (backend == "auto" || backend == "poll")
+		return true;
+#ifdef __linux__
+	// io_uring may still be missing at build or run time; create() then
+	// falls back to epoll
+	if (backend == "epoll" || backend == "io_uring")
+		return true;
+#endif
+	return false;
+}
+
+Reactor* Reactor::create(const std::string& backend) {
+#ifdef WEBSERV_HAVE_IO_URING
+	if (backend == "io_uring") {
+		try {
+			return new UringReactor();
+		} catch (const std::exception& e) {
+			// Old kernel, seccomp, io_uring_disabled sysctl...
+			std::cerr << e.what() << ", falling back to epoll" << std::endl;
+			return new EpollReactor();
+		}
+	}
+#elif defined(__linux__)
+	if (backend == "io_uring") {
+		std::cerr << "Built without io_uring support, falling back to epoll" << std::endl;
+		return new EpollReactor();
+	}
+#endif
+#ifdef __linux__
+	if (backend == "epoll" || backend == "auto")
+		return new EpollReactor();
+#endif
+	if (backend == "poll" || backend == "auto")
+		return new PollReactor();
+	throw std::runtime_error("Unsupported event backend: " + backend);
+}
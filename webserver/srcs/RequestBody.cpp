@@ -0,0 +1,160 @@
+#include "RequestBody.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#ifdef __linux__
+    #include <sys/sendfile.h>
+#endif
+
+RequestBody::RequestBody()
+    : buffer_size(static_cast<size_t>(-1)), length(0), fd(-1), mapping(NULL) {
+}
+
+RequestBody::~RequestBody() {
+    reset();
+}
+
+void RequestBody::reset() {
+    if (mapping) {
+        munmap(mapping, length);
+        mapping = NULL;
+    }
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+    // Give back the memory if a large body grew it
+    if (memory.capacity() > BODY_COPY_CHUNK)
+        std::string().swap(memory);
+    else
+        memory.clear();
+    length = 0;
+    buffer_size = static_cast<size_t>(-1);
+}
+
+// Move the in-memory part to a temp file that is unlinked right away, so
+// it disappears with the descriptor whatever happens to the process
+bool RequestBody::spool() {
+    char path[] = BODY_TEMP_DIR "/webserv_body_XXXXXX";
+    fd = mkstemp(path);
+    if (fd < 0)
+        return false;
+    unlink(path);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    const char* data = memory.data();
+    size_t left = memory.size();
+    while (left > 0) {
+        ssize_t written = ::write(fd, data, left);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        data += written;
+        left -= written;
+    }
+    std::string().swap(memory);
+    return true;
+}
+
+bool RequestBody::write(const char* data, size_t size) {
+    if (fd < 0) {
+        if (length + size <= buffer_size) {
+            memory.append(data, size);
+            length += size;
+            return true;
+        }
+        if (!spool())
+            return false;
+    }
+
+    size_t left = size;
+    while (left > 0) {
+        ssize_t written = ::write(fd, data, left);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        data += written;
+        left -= written;
+    }
+    length += size;
+    return true;
+}
+
+const char* RequestBody::data() const {
+    if (fd < 0)
+        return memory.data();
+    if (!mapping) {
+        void* p = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED)
+            return NULL;
+        // Read once front to back: let the kernel read ahead and drop behind
+        madvise(p, length, MADV_SEQUENTIAL);
+        mapping = p;
+    }
+    return static_cast<const char*>(mapping);
+}
+
+void RequestBody::release(size_t offset, size_t size) const {
+    if (!mapping)
+        return;
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t begin = (offset + page - 1) / page * page;
+    size_t end = (offset + size) / page * page;
+    if (end > begin)
+        madvise(static_cast<char*>(mapping) + begin, end - begin, MADV_DONTNEED);
+}
+
+ssize_t RequestBody::read(size_t offset, char* buffer, size_t size) const {
+    if (offset >= length)
+        return 0;
+    if (size > length - offset)
+        size = length - offset;
+    if (fd < 0) {
+        std::memcpy(buffer, memory.data() + offset, size);
+        return size;
+    }
+    return pread(fd, buffer, size, offset);
+}
+
+bool RequestBody::copyTo(int out_fd, size_t offset, size_t size) const {
+    if (offset > length || size > length - offset)
+        return false;
+
+    while (size > 0) {
+        ssize_t written;
+        if (fd < 0) {
+            written = ::write(out_fd, memory.data() + offset, size);
+        } else {
+#ifdef __linux__
+            // File to file inside the kernel
+            off_t in_offset = offset;
+            written = sendfile(out_fd, fd, &in_offset, size);
+#else
+            char chunk[BODY_COPY_CHUNK];
+            ssize_t got = read(offset, chunk, size < sizeof(chunk) ? size : sizeof(chunk));
+            written = got > 0 ? ::write(out_fd, chunk, got) : got;
+#endif
+        }
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        offset += written;
+        size -= written;
+    }
+    return true;
+}
+
+std::string RequestBody::str() const {
+    if (fd < 0)
+        return memory;
+    std::string copy(length, '\0');
+    if (length && read(0, &copy[0], length) != static_cast<ssize_t>(length))
+        return std::string();
+    return copy;
+}
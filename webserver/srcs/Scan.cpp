@@ -0,0 +1,203 @@
+#include "Scan.hpp"
+#include <cstring>
+
+// SSE2 is part of the x86-64 baseline, so only AVX2 needs a target attribute
+#if defined(__GNUC__) && defined(__x86_64__)
+    #define SCAN_X86 1
+    #include <immintrin.h>
+#endif
+
+typedef const char* (*CharKernel)(const char*, const char*, char);
+typedef const char* (*SubstringKernel)(const char*, const char*, const char*, size_t);
+
+//
+/* Scalar */
+//
+
+static const char* scanCharScalar(const char* p, const char* end, char c) {
+    for (; p < end; ++p) {
+        if (*p == c)
+            return p;
+    }
+    return NULL;
+}
+
+static const char* scanSubstringScalar(const char* p, const char* end,
+                                       const char* needle, size_t needle_len) {
+    if (needle_len == 0)
+        return p;
+    for (; end - p >= static_cast<ptrdiff_t>(needle_len); ++p) {
+        if (*p == needle[0] && std::memcmp(p + 1, needle + 1, needle_len - 1) == 0)
+            return p;
+    }
+    return NULL;
+}
+
+#ifdef SCAN_X86
+
+//
+/* SSE2: 16 bytes per step */
+//
+
+// The 16-byte loops are forced inline so the AVX2 kernels reuse them
+// VEX-encoded; calling legacy SSE code with dirty upper AVX state stalls.
+#define SCAN_INLINE static inline __attribute__((always_inline))
+
+SCAN_INLINE const char* scanChar16(const char* p, const char* end, char c) {
+    const char* begin = p;
+    const __m128i target = _mm_set1_epi8(c);
+    for (; end - p >= 16; p += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, target));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+    if (p == end)
+        return NULL;
+    if (end - begin < 16)
+        return scanCharScalar(p, end, c);
+
+    // Tail: one block ending at `end`, overlapping bytes already checked
+    const char* last = end - 16;
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last));
+    unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, target)) >> (p - last);
+    return mask ? p + __builtin_ctz(mask) : NULL;
+}
+
+// Candidates are positions where both the first and the last byte of the
+// needle match; only those are compared in full
+SCAN_INLINE const char* scanSubstring16(const char* p, const char* end,
+                                        const char* needle, size_t needle_len) {
+    if (needle_len < 2)
+        return needle_len ? scanChar16(p, end, needle[0]) : p;
+
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_len - 1]);
+    for (; end - p >= static_cast<ptrdiff_t>(needle_len + 15); p += 16) {
+        __m128i head = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i tail = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + needle_len - 1));
+        unsigned int mask = _mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, last)));
+        while (mask) {
+            unsigned int bit = __builtin_ctz(mask);
+            if (std::memcmp(p + bit + 1, needle + 1, needle_len - 2) == 0)
+                return p + bit;
+            mask &= mask - 1;
+        }
+    }
+    return scanSubstringScalar(p, end, needle, needle_len);
+}
+
+static const char* scanCharSse2(const char* p, const char* end, char c) {
+    return scanChar16(p, end, c);
+}
+
+static const char* scanSubstringSse2(const char* p, const char* end,
+                                     const char* needle, size_t needle_len) {
+    return scanSubstring16(p, end, needle, needle_len);
+}
+
+//
+/* AVX2: 32 bytes per step */
+//
+
+__attribute__((target("avx2")))
+static const char* scanCharAvx2(const char* p, const char* end, char c) {
+    const char* begin = p;
+    const __m256i target = _mm256_set1_epi8(c);
+    for (; end - p >= 32; p += 32) {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, target));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+    if (p == end)
+        return NULL;
+    if (end - begin < 32)
+        return scanChar16(p, end, c);
+
+    // Tail: one block ending at `end`, overlapping bytes already checked
+    const char* last = end - 32;
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(last));
+    unsigned int mask = static_cast<unsigned int>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, target))) >> (p - last);
+    return mask ? p + __builtin_ctz(mask) : NULL;
+}
+
+__attribute__((target("avx2")))
+static const char* scanSubstringAvx2(const char* p, const char* end,
+                                     const char* needle, size_t needle_len) {
+    if (needle_len < 2)
+        return needle_len ? scanCharAvx2(p, end, needle[0]) : p;
+
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_len - 1]);
+    for (; end - p >= static_cast<ptrdiff_t>(needle_len + 31); p += 32) {
+        __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i tail = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + needle_len - 1));
+        unsigned int mask = _mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, last)));
+        while (mask) {
+            unsigned int bit = __builtin_ctz(mask);
+            if (std::memcmp(p + bit + 1, needle + 1, needle_len - 2) == 0)
+                return p + bit;
+            mask &= mask - 1;
+        }
+    }
+    return scanSubstring16(p, end, needle, needle_len);
+}
+
+#endif // SCAN_X86
+
+//
+/* Dispatch */
+//
+
+struct ScanKernels {
+    const char* name;
+    CharKernel find_char;
+    SubstringKernel find_substring;
+};
+
+static ScanKernels selectKernels(const char* name) {
+    ScanKernels kernels = { "scalar", scanCharScalar, scanSubstringScalar };
+#ifdef SCAN_X86
+    __builtin_cpu_init();
+    bool want_any = name == NULL;
+    if ((want_any || std::strcmp(name, "avx2") == 0) && __builtin_cpu_supports("avx2")) {
+        kernels.name = "avx2";
+        kernels.find_char = scanCharAvx2;
+        kernels.find_substring = scanSubstringAvx2;
+    } else if (want_any || std::strcmp(name, "sse2") == 0) {
+        kernels.name = "sse2";
+        kernels.find_char = scanCharSse2;
+        kernels.find_substring = scanSubstringSse2;
+    }
+#else
+    (void)name;
+#endif
+    return kernels;
+}
+
+// Chosen during static initialization, before any worker thread exists
+static ScanKernels g_kernels = selectKernels(NULL);
+
+const char* scanChar(const char* begin, const char* end, char c) {
+    return g_kernels.find_char(begin, end, c);
+}
+
+const char* scanSubstring(const char* begin, const char* end, const char* needle, size_t needle_len) {
+    return g_kernels.find_substring(begin, end, needle, needle_len);
+}
+
+const char* scanKernel() {
+    return g_kernels.name;
+}
+
+bool scanSetKernel(const char* name) {
+    ScanKernels kernels = selectKernels(name);
+    if (std::strcmp(kernels.name, name) != 0)
+        return false;
+    g_kernels = kernels;
+    return true;
+}
@@ -0,0 +1,40 @@
+#include "SharedFile.hpp"
+
+#include <unistd.h>
+
+SharedFile::SharedFile() : _handle(NULL) {}
+
+SharedFile::SharedFile(int fd) : _handle(NULL) {
+	if (fd >= 0) {
+		_handle = new Handle();
+		_handle->refs = 1;
+		_handle->fd = fd;
+	}
+}
+
+SharedFile::SharedFile(const SharedFile& other) : _handle(other._handle) {
+	if (_handle)
+		_handle->refs++;
+}
+
+SharedFile& SharedFile::operator=(const SharedFile& other) {
+	if (_handle != other._handle) {
+		_release();
+		_handle = other._handle;
+		if (_handle)
+			_handle->refs++;
+	}
+	return *this;
+}
+
+SharedFile::~SharedFile() {
+	_release();
+}
+
+void SharedFile::_release() {
+	if (_handle && --_handle->refs == 0) {
+		close(_handle->fd);
+		delete _handle;
+	}
+	_handle = NULL;
+}
@@ -1,13 +1,71 @@
 #include "StaticFileHandler.hpp"
-#include <fstream>
+#include "UriPath.hpp"
 #include <sstream>
 #include <sys/stat.h>
 #include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <dirent.h>
+#include <fcntl.h>
 #include <unistd.h>
 
-#define PATH_SEPARATOR '/'
+// Closes a descriptor when it goes out of scope
+class ScopedFd {
+private:
+    int fd;
+
+    ScopedFd(const ScopedFd&);
+    ScopedFd& operator=(const ScopedFd&);
+
+public:
+    explicit ScopedFd(int descriptor) : fd(descriptor) {}
+    ~ScopedFd() { if (fd >= 0) close(fd); }
+
+    int get() const { return fd; }
+    int release() {
+        int released = fd;
+        fd = -1;
+        return released;
+    }
+};
+
+// Why a file couldn't be opened, as a response
+static HttpResponse openError() {
+    if (errno == ENOENT || errno == ENOTDIR)
+        return HttpResponse::notFound("The requested resource was not found");
+    // EXDEV/ELOOP: a symlink out of the root; EACCES: permissions
+    return HttpResponse::error(403);
+}
+
+// Files are opened with O_NONBLOCK, so a FIFO can't hold the worker in
+// open() until a writer shows up. Once fstat has shown a regular file the
+// flag is dropped again, and the descriptor is handed on like any other.
+static int openNonBlocking(int dir_fd, const char* path) {
+    return openBeneath(dir_fd, path, O_RDONLY | O_NONBLOCK);
+}
+
+static bool clearNonBlocking(int fd) {
+    int flags = fcntl(fd, F_GETFL);
+    return flags != -1 && fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) == 0;
+}
+
+// 200 with the contents moved in as the body, not copied
+static HttpResponse contentResponse(std::string& content, const std::string& mime_type) {
+    HttpResponse response(200);
+    response.setContentType(mime_type);
+    response.adoptBody(content);
+    return response;
+}
+
+// 200 whose body is sent straight from the open file
+static HttpResponse fileResponse(ScopedFd& file, const struct stat& info, const std::string& mime_type) {
+    HttpResponse response(200);
+    response.setContentType(mime_type);
+    response.setFileBody(SharedFile(file.release()), info.st_size);
+    response.setHeader("ETag", HttpResponse::entityTag(info.st_mtime, info.st_size));
+    response.setHeader("Last-Modified", HttpResponse::httpDate(info.st_mtime));
+    return response;
+}
 
 StaticFileHandler::StaticFileHandler(const std::string& root, bool dir_listing, 
                                      const std::string& def_file)
@@ -45,67 +103,7 @@ std::string StaticFileHandler::getMimeType(const std::string& path) const {
     return "application/octet-stream";
 }
 
-bool StaticFileHandler::fileExists(const std::string& path) const {
-    struct stat buffer;
-    return (stat(path.c_str(), &buffer) == 0);
-}
-
-bool StaticFileHandler::isDirectory(const std::string& path) const {
-    struct stat buffer;
-    if (stat(path.c_str(), &buffer) != 0)
-        return false;
-    return S_ISDIR(buffer.st_mode);
-}
-
-std::string StaticFileHandler::readFile(const std::string& path, bool& success) const {
-    std::ifstream file(path.c_str(), std::ios::binary);
-    if (!file.is_open()) {
-        success = false;
-        return "";
-    }
-    
-    std::ostringstream oss;
-    oss << file.rdbuf();
-    success = true;
-    return oss.str();
-}
-
-std::string StaticFileHandler::combinePaths(const std::string& base, 
-                                           const std::string& relative) const {
-    std::string result = base;
-    
-    // Ensure base ends with separator
-    if (!result.empty() && result[result.length() - 1] != '/' && 
-        result[result.length() - 1] != '\\') {
-        result += PATH_SEPARATOR;
-    }
-    
-    // Remove leading slash from relative path
-    std::string rel = relative;
-    if (!rel.empty() && (rel[0] == '/' || rel[0] == '\\')) {
-        rel = rel.substr(1);
-    }
-    
-    // Replace forward slashes with platform separator
-    for (size_t i = 0; i < rel.length(); ++i) {
-        if (rel[i] == '/' || rel[i] == '\\')
-            rel[i] = PATH_SEPARATOR;
-    }
-    
-    return result + rel;
-}
-
-bool StaticFileHandler::isPathSafe(const std::string& path) const {
-    // Prevent directory traversal attacks
-    if (path.find("..") != std::string::npos)
-        return false;
-    
-    // Additional security checks could be added here
-    return true;
-}
-
-std::string StaticFileHandler::generateDirectoryListing(const std::string& dir_path, 
-                                                        const std::string& uri) const {
+std::string StaticFileHandler::generateDirectoryListing(int dir_fd, const std::string& uri) const {
     std::ostringstream html;
     html << "<html><head><title>Index of " << uri << "</title>";
     html << "<style>"
@@ -125,14 +123,16 @@ std::string StaticFileHandler::generateDirectoryListing(const std::string& dir_p
         html << "<tr><td><a href=\"..\">..</a></td><td>Directory</td></tr>";
     }
     
-    DIR* dir = opendir(dir_path.c_str());
+    // fdopendir takes ownership of its descriptor, so give it a copy
+    int list_fd = dup(dir_fd);
+    DIR* dir = list_fd >= 0 ? fdopendir(list_fd) : NULL;
     if (dir) {
         struct dirent* entry;
         while ((entry = readdir(dir)) != NULL) {
             std::string name = entry->d_name;
             if (name != "." && name != "..") {
-                std::string full_path = combinePaths(dir_path, name);
-                bool is_dir = isDirectory(full_path);
+                struct stat info;
+                bool is_dir = fstatat(dirfd(dir), entry->d_name, &info, 0) == 0 && S_ISDIR(info.st_mode);
                 std::string link = name;
                 if (is_dir) link += "/";
                 
@@ -142,89 +142,105 @@ std::string StaticFileHandler::generateDirectoryListing(const std::string& dir_p
             }
         }
         closedir(dir);
+    } else if (list_fd >= 0) {
+        close(list_fd);
     }
     
     html << "</table></body></html>";
     return html.str();
 }
 
-HttpResponse StaticFileHandler::handleRequest(const HttpRequest& request) {
-    HttpMethod method = request.getMethod();
-    
-    std::string uri = request.getUri();
-    
-    // Security check
-    if (!isPathSafe(uri)) {
-        return HttpResponse::badRequest("Invalid path");
-    }
-    
-    // Build full file path
-    std::string file_path = combinePaths(root_directory, uri);
+// One open beneath the root and one fstat per file served; the contents
+// are never read here
+HttpResponse StaticFileHandler::serveFile(int root_fd, const std::string& uri) const {
+    ScopedFd file(openNonBlocking(root_fd, uri.c_str() + 1));
+    if (file.get() < 0)
+        return openError();
+    
+    struct stat info;
+    if (fstat(file.get(), &info) != 0)
+        return HttpResponse::internalServerError("Failed to read file");
     
-    // Handle DELETE method
-    if (method == DELETE) {
-        if (!fileExists(file_path)) {
-            return HttpResponse::notFound("The requested resource was not found");
-        }
-        
-        // Prevent deletion of index files
-        if (uri == "/" || uri.empty()) {
-            return HttpResponse::methodNotAllowed("Cannot delete index file");
-        }
-        
-        // Check if it's a default file (index.html, etc.)
-        size_t last_slash = file_path.find_last_of('/');
-        std::string filename = (last_slash != std::string::npos) ? file_path.substr(last_slash + 1) : file_path;
-        if (filename == default_file || filename == "index.html" || filename == "index.htm") {
-            return HttpResponse::methodNotAllowed("Cannot delete index files");
-        }
+    // If it's a directory
+    if (S_ISDIR(info.st_mode)) {
+        // Try to serve default file
+        ScopedFd index(openNonBlocking(file.get(), default_file.c_str()));
+        struct stat index_info;
+        if (index.get() >= 0 && fstat(index.get(), &index_info) == 0 && S_ISREG(index_info.st_mode)
+            && clearNonBlocking(index.get()))
+            return fileResponse(index, index_info, getMimeType(default_file));
         
-        if (remove(file_path.c_str()) == 0) {
-            return HttpResponse::ok("<html><body><h1>200 OK</h1><p>File deleted successfully</p></body></html>", "text/html");
+        // If no default file, check if directory listing is enabled
+        if (directory_listing_enabled) {
+            std::string listing = generateDirectoryListing(file.get(), uri);
+            return contentResponse(listing, "text/html");
         } else {
-            // Return 403 Forbidden instead of 500 for permission errors
-            return HttpResponse::methodNotAllowed("Permission denied: Cannot delete file");
+            return HttpResponse::notFound("Directory listing is disabled");
         }
     }
     
-    // Only handle GET and HEAD requests for static files
-    if (method != GET && method != HEAD) {
-        return HttpResponse::methodNotAllowed("Only GET and HEAD are allowed for static files");
+    if (!S_ISREG(info.st_mode))
+        return HttpResponse::error(403);
+    if (!clearNonBlocking(file.get()))
+        return HttpResponse::internalServerError("Failed to read file");
+    
+    // It's a file - the body is sent from the descriptor as it is
+    return fileResponse(file, info, getMimeType(uri));
+}
+
+HttpResponse StaticFileHandler::deleteFile(int root_fd, const std::string& uri) const {
+    // Prevent deletion of index files
+    if (uri == "/") {
+        return HttpResponse::methodNotAllowed("Cannot delete index file");
     }
     
-    // Check if file/directory exists
-    if (!fileExists(file_path)) {
+    // Split "/dir/name[/]" into the parent directory and the entry in it
+    std::string path = uri.substr(1);
+    if (path[path.length() - 1] == '/')
+        path.erase(path.length() - 1);
+    size_t last_slash = path.find_last_of('/');
+    std::string parent = (last_slash != std::string::npos) ? path.substr(0, last_slash) : "";
+    std::string filename = (last_slash != std::string::npos) ? path.substr(last_slash + 1) : path;
+    
+    // Check if it's a default file (index.html, etc.)
+    if (filename == default_file || filename == "index.html" || filename == "index.htm") {
+        return HttpResponse::methodNotAllowed("Cannot delete index files");
+    }
+    
+    ScopedFd dir(openBeneath(root_fd, parent.c_str(), O_PATH | O_DIRECTORY));
+    if (dir.get() < 0)
+        return openError();
+    
+    // Same as remove(): unlink files, rmdir empty directories
+    int result = unlinkat(dir.get(), filename.c_str(), 0);
+    if (result != 0 && errno == EISDIR)
+        result = unlinkat(dir.get(), filename.c_str(), AT_REMOVEDIR);
+    if (result == 0) {
+        return HttpResponse::ok("<html><body><h1>200 OK</h1><p>File deleted successfully</p></body></html>", "text/html");
+    } else if (errno == ENOENT) {
         return HttpResponse::notFound("The requested resource was not found");
+    } else {
+        // Return 403 Forbidden instead of 500 for permission errors
+        return HttpResponse::methodNotAllowed("Permission denied: Cannot delete file");
     }
+}
+
+// The URI is already decoded and normalized by the parser; the kernel
+// keeps every open inside the root, symlinks included
+HttpResponse StaticFileHandler::handleRequest(const HttpRequest& request) {
+    HttpMethod method = request.getMethod();
     
-    // If it's a directory
-    if (isDirectory(file_path)) {
-        // Try to serve default file
-        std::string index_path = combinePaths(file_path, default_file);
-        if (fileExists(index_path) && !isDirectory(index_path)) {
-            bool success;
-            std::string content = readFile(index_path, success);
-            if (success) {
-                HttpResponse response = HttpResponse::ok(content, getMimeType(index_path));
-                return response;
-            }
-        }
-        
-        // If no default file, check if directory listing is enabled
-        if (directory_listing_enabled) {
-            std::string listing = generateDirectoryListing(file_path, uri);
-            return HttpResponse::ok(listing, "text/html");
-        } else {
-            return HttpResponse::notFound("Directory listing is disabled");
-        }
+    // Only handle GET, HEAD and DELETE requests for static files
+    if (method != GET && method != HEAD && method != DELETE) {
+        return HttpResponse::methodNotAllowed("Only GET and HEAD are allowed for static files");
     }
     
-    // It's a file - read and serve it
-    bool success;
-    std::string content = readFile(file_path, success);
-    if (!success) {
-        return HttpResponse::internalServerError("Failed to read file");
+    ScopedFd root(open(root_directory.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC));
+    if (root.get() < 0) {
+        return HttpResponse::notFound("The requested resource was not found");
     }
     
-    return HttpResponse::ok(content, getMimeType(file_path));
+    if (method == DELETE)
+        return deleteFile(root.get(), request.getUri());
+    return serveFile(root.get(), request.getUri());
 }
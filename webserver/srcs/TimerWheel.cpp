@@ -0,0 +1,115 @@
+#include "TimerWheel.hpp"
+
+#define TIMER_MASK (TIMER_SLOTS - 1)
+
+//
+/* TimerNode */
+//
+
+TimerNode::TimerNode() : prev(NULL), next(NULL), expires(0), id(-1), kind(0) {}
+
+TimerNode::~TimerNode() {
+	unlink();
+}
+
+void TimerNode::unlink() {
+	if (!next)
+		return;
+	prev->next = next;
+	next->prev = prev;
+	prev = NULL;
+	next = NULL;
+}
+
+//
+/* TimerWheel */
+//
+
+TimerWheel::TimerWheel(unsigned long now_ms) : _current(now_ms / TIMER_TICK_MS) {
+	for (int level = 0; level < TIMER_LEVELS; ++level) {
+		for (int slot = 0; slot < TIMER_SLOTS; ++slot) {
+			_slots[level][slot].prev = &_slots[level][slot];
+			_slots[level][slot].next = &_slots[level][slot];
+		}
+	}
+}
+
+void TimerWheel::_insert(TimerNode& node) {
+	if (node.expires < _current)
+		node.expires = _current;
+
+	// The level is chosen by distance, the slot by the expiry tick itself
+	unsigned long delta = node.expires - _current;
+	int level = 0;
+	while (level < TIMER_LEVELS - 1 && delta >= (1UL << ((level + 1) * TIMER_LEVEL_BITS)))
+		level++;
+	if (level == TIMER_LEVELS - 1 && delta >= (1UL << (TIMER_LEVELS * TIMER_LEVEL_BITS)))
+		node.expires = _current + (1UL << (TIMER_LEVELS * TIMER_LEVEL_BITS)) - 1;
+
+	TimerNode& head = _slots[level][(node.expires >> (level * TIMER_LEVEL_BITS)) & TIMER_MASK];
+	node.prev = head.prev;
+	node.next = &head;
+	head.prev->next = &node;
+	head.prev = &node;
+}
+
+// Redistribute the current slot of `level` into the finer levels
+void TimerWheel::_cascade(int level) {
+	TimerNode& head = _slots[level][(_current >> (level * TIMER_LEVEL_BITS)) & TIMER_MASK];
+	while (head.next != &head) {
+		TimerNode* node = head.next;
+		node->unlink();
+		_insert(*node);
+	}
+}
+
+void TimerWheel::arm(TimerNode& node, unsigned long now_ms, unsigned long delay_ms) {
+	node.unlink();
+	node.expires = (now_ms + delay_ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+	_insert(node);
+}
+
+void TimerWheel::cancel(TimerNode& node) {
+	node.unlink();
+}
+
+void TimerWheel::advance(unsigned long now_ms, std::vector<TimerNode*>& expired) {
+	unsigned long target = now_ms / TIMER_TICK_MS;
+
+	while (_current <= target) {
+		// Entering a new lap of a level pulls the next coarser slot down
+		for (int level = 1; level < TIMER_LEVELS; ++level) {
+			if ((_current & ((1UL << (level * TIMER_LEVEL_BITS)) - 1)) != 0)
+				break;
+			_cascade(level);
+		}
+
+		TimerNode& head = _slots[0][_current & TIMER_MASK];
+		while (head.next != &head) {
+			TimerNode* node = head.next;
+			node->unlink();
+			expired.push_back(node);
+		}
+		_current++;
+	}
+}
+
+int TimerWheel::nextTimeout(unsigned long now_ms, int max_ms) const {
+	// Only the finest level is scanned; coarser timers are at least a lap away
+	unsigned long last_tick = (now_ms + max_ms) / TIMER_TICK_MS;
+	unsigned long max_ticks = last_tick >= _current ? last_tick - _current + 1 : 0;
+	if (max_ticks > TIMER_SLOTS)
+		max_ticks = TIMER_SLOTS;
+
+	for (unsigned long i = 0; i < max_ticks; ++i) {
+		unsigned long tick = _current + i;
+		const TimerNode& head = _slots[0][tick & TIMER_MASK];
+
+		// A lap boundary may cascade coarser timers due from that tick on
+		if (head.next != &head || (tick & TIMER_MASK) == 0) {
+			unsigned long due_ms = tick * TIMER_TICK_MS;
+			return due_ms > now_ms ? static_cast<int>(due_ms - now_ms) : 0;
+		}
+	}
+	return max_ms;
+}
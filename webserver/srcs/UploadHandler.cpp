@@ -1,8 +1,10 @@
 #include "UploadHandler.hpp"
-#include <fstream>
+#include "Scan.hpp"
 #include <sstream>
 #include <algorithm>
+#include <cstring>
 #include <sys/stat.h>
+#include <fcntl.h>
 
 #ifdef _WIN32
     #include <direct.h>
@@ -62,33 +64,68 @@ std::string UploadHandler::sanitizeFilename(const std::string& filename) const {
     return result;
 }
 
-bool UploadHandler::saveFile(const std::string& filename, const std::string& content) {
+bool UploadHandler::saveFile(const std::string& filename, const RequestBody& body,
+                             size_t offset, size_t size) {
     std::string full_path = upload_directory;
     if (!full_path.empty() && full_path[full_path.length() - 1] != PATH_SEPARATOR) {
         full_path += PATH_SEPARATOR;
     }
     full_path += filename;
     
-    std::ofstream file(full_path.c_str(), std::ios::binary);
-    if (!file.is_open())
+    int fd = open(full_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
         return false;
     
-    file.write(content.c_str(), content.length());
-    file.close();
+    // Straight from the body (memory or spool file), no intermediate copy
+    bool ok = body.copyTo(fd, offset, size);
+    close(fd);
     
-    return true;
+    return ok;
 }
 
-bool UploadHandler::parseMultipartFormData(const std::string& body, 
+#define SCAN_WINDOW (4 * 1024 * 1024)
+
+// Offset of needle in the body at or after pos, npos if absent. Scans a
+// window at a time and releases what it passed, so searching a spooled
+// body doesn't keep the whole mapping resident.
+static size_t findIn(const RequestBody& body, const char* data, const std::string& needle, size_t pos) {
+    size_t length = body.size();
+    while (pos < length) {
+        size_t window_end = length - pos > SCAN_WINDOW ? pos + SCAN_WINDOW : length;
+        // Overlap so a match straddling the window edge is still found
+        size_t stop = length - window_end > needle.length() ? window_end + needle.length() - 1 : length;
+        const char* found = scanSubstring(data + pos, data + stop, needle.data(), needle.length());
+        if (found)
+            return static_cast<size_t>(found - data);
+        body.release(pos, window_end - pos);
+        pos = window_end;
+    }
+    return std::string::npos;
+}
+
+static bool startsWith(const char* body, size_t length, size_t pos, const char* prefix) {
+    size_t prefix_len = std::strlen(prefix);
+    return pos + prefix_len <= length && std::memcmp(body + pos, prefix, prefix_len) == 0;
+}
+
+// Works on pointer slices of the body: only part headers are copied,
+// file contents are recorded as offsets
+bool UploadHandler::parseMultipartFormData(const RequestBody& request_body,
                                           const std::string& boundary,
                                           std::vector<UploadedFile>& files) {
+    // A spooled body is mmap'd
+    const char* body = request_body.data();
+    size_t length = request_body.size();
+    if (!body)
+        return false;
+    
     std::string delimiter = "--" + boundary;
-    std::string end_delimiter = "--" + boundary + "--";
+    std::string header_end = "\r\n\r\n";
     
     size_t pos = 0;
-    while (pos < body.length()) {
+    while (pos < length) {
         // Find next boundary
-        size_t boundary_pos = body.find(delimiter, pos);
+        size_t boundary_pos = findIn(request_body, body, delimiter, pos);
         if (boundary_pos == std::string::npos)
             break;
         
@@ -96,37 +133,35 @@ bool UploadHandler::parseMultipartFormData(const std::string& body,
         pos = boundary_pos + delimiter.length();
         
         // Check for end delimiter
-        if (pos + 2 <= body.length() && body.substr(pos, 2) == "--")
+        if (startsWith(body, length, pos, "--"))
             break;
         
         // Skip CRLF after boundary
-        if (pos + 2 <= body.length() && body.substr(pos, 2) == "\r\n")
+        if (startsWith(body, length, pos, "\r\n"))
             pos += 2;
         
         // Find the empty line that separates headers from content
-        size_t headers_end = body.find("\r\n\r\n", pos);
+        size_t headers_end = findIn(request_body, body, header_end, pos);
         if (headers_end == std::string::npos)
             break;
         
-        std::string headers_section = body.substr(pos, headers_end - pos);
+        std::string headers_section(body + pos, headers_end - pos);
         pos = headers_end + 4; // Skip \r\n\r\n
         
         // Find the next boundary to get content length
-        size_t next_boundary = body.find(delimiter, pos);
+        size_t next_boundary = findIn(request_body, body, delimiter, pos);
         if (next_boundary == std::string::npos)
             break;
         
         // Content is between current pos and next boundary (minus \r\n before boundary)
-        size_t content_end = next_boundary - 2;
-        if (content_end <= pos)
+        if (next_boundary < pos + 2)
             break;
-        
-        std::string content = body.substr(pos, content_end - pos);
+        size_t content_end = next_boundary - 2;
         
         // Parse headers to extract filename and content-type
         UploadedFile file;
-        file.content = content;
-        file.size = content.length();
+        file.offset = pos;
+        file.size = content_end - pos;
         file.content_type = "application/octet-stream";
         
         // Parse Content-Disposition header
@@ -193,8 +228,9 @@ HttpResponse UploadHandler::handleUpload(const HttpRequest& request) {
     }
     
     // Parse multipart form data
+    const RequestBody& body = request.getBody();
     std::vector<UploadedFile> files;
-    if (!parseMultipartFormData(request.getBody(), boundary, files)) {
+    if (!parseMultipartFormData(body, boundary, files)) {
         return HttpResponse::badRequest("Failed to parse multipart/form-data");
     }
     
@@ -202,7 +238,7 @@ HttpResponse UploadHandler::handleUpload(const HttpRequest& request) {
     std::vector<std::string> saved_files;
     for (size_t i = 0; i < files.size(); ++i) {
         std::string safe_filename = sanitizeFilename(files[i].filename);
-        if (saveFile(safe_filename, files[i].content)) {
+        if (saveFile(safe_filename, body, files[i].offset, files[i].size)) {
             saved_files.push_back(safe_filename);
         }
     }
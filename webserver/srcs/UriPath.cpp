@@ -0,0 +1,141 @@
+#include "UriPath.hpp"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__linux__) && defined(__has_include)
+# if __has_include(<linux/openat2.h>)
+#  include <linux/openat2.h>
+#  include <sys/syscall.h>
+#  ifdef SYS_openat2
+#   define WEBSERV_HAVE_OPENAT2 1
+#  endif
+# endif
+#endif
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+//
+/* Normalization */
+//
+
+// Each segment is decoded straight into out; when its closing '/' (or the
+// end) is reached it is kept, dropped (".") or removes its parent ("..").
+// A decoded "%2F" separates segments like a literal '/'.
+bool normalizeUriPath(const char* path, size_t length, std::string& out) {
+    if (length == 0 || path[0] != '/')
+        return false;
+
+    out.clear();
+    out.reserve(length);
+    out += '/';
+    size_t segment = 1; // Where the segment being decoded starts in out
+
+    for (size_t i = 1; i <= length; ++i) {
+        char c = '/'; // The end closes the last segment
+        if (i < length) {
+            c = path[i];
+            if (c == '%') {
+                if (i + 2 >= length)
+                    return false;
+                int high = hexValue(path[i + 1]);
+                int low = hexValue(path[i + 2]);
+                if (high < 0 || low < 0)
+                    return false;
+                c = static_cast<char>(high * 16 + low);
+                i += 2;
+            }
+            if (c == '\0')
+                return false;
+            if (c != '/') {
+                out += c;
+                continue;
+            }
+        }
+
+        size_t segment_length = out.size() - segment;
+        if (segment_length == 0)
+            continue; // Repeated slash
+        if (segment_length == 1 && out[segment] == '.') {
+            out.resize(segment);
+        } else if (segment_length == 2 && out[segment] == '.' && out[segment + 1] == '.') {
+            if (segment == 1)
+                return false; // Above the root
+            segment = out.rfind('/', segment - 2) + 1;
+            out.resize(segment);
+        } else if (i < length) {
+            out += '/';
+            segment = out.size();
+        }
+    }
+    return true;
+}
+
+//
+/* Opening beneath a directory */
+//
+
+// Component by component, refusing every symlink: stricter than
+// RESOLVE_BENEATH, which allows links that stay inside
+static int openWalk(int dir_fd, const char* path, int flags, int mode) {
+    const char* name = path;
+    int current = dir_fd;
+
+    for (;;) {
+        const char* slash = std::strchr(name, '/');
+        size_t length = slash ? static_cast<size_t>(slash - name) : std::strlen(name);
+        std::string component(name, length);
+
+        int fd;
+        if (component == "..") {
+            errno = EXDEV;
+            fd = -1;
+        } else if (!slash) {
+            fd = openat(current, component.c_str(), flags | O_NOFOLLOW | O_CLOEXEC, mode);
+        } else {
+            fd = openat(current, component.c_str(), O_PATH | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        }
+
+        if (current != dir_fd) {
+            int saved = errno;
+            close(current);
+            errno = saved;
+        }
+        if (fd < 0 || !slash)
+            return fd;
+
+        current = fd;
+        name = slash + 1;
+        while (*name == '/')
+            name++;
+        if (*name == '\0')
+            name = "."; // Trailing slash: the directory itself
+    }
+}
+
+int openBeneath(int dir_fd, const char* path, int flags, int mode) {
+    if (path[0] == '/') {
+        errno = EXDEV;
+        return -1;
+    }
+    if (path[0] == '\0')
+        path = ".";
+
+#ifdef WEBSERV_HAVE_OPENAT2
+    struct open_how how;
+    std::memset(&how, 0, sizeof(how));
+    how.flags = flags | O_CLOEXEC;
+    how.mode = (flags & O_CREAT) ? mode : 0;
+    how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+    int fd = static_cast<int>(syscall(SYS_openat2, dir_fd, path, &how, sizeof(how)));
+    if (fd >= 0 || errno != ENOSYS)
+        return fd; // ENOSYS: kernel older than 5.6
+#endif
+    return openWalk(dir_fd, path, flags, mode);
+}
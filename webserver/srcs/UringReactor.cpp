@@ -0,0 +1,526 @@
+#include "UringReactor.hpp"
+
+#ifdef WEBSERV_HAVE_IO_URING
+
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <cstdio>
+#include <poll.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+
+#define URING_IGNORE 0xffffffffffffffffULL // user_data of requests whose completion we drop
+#define URING_BUFFER_GROUP 0
+
+static int sysSetup(unsigned int entries, struct io_uring_params* params) {
+	return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int sysRegister(int ring_fd, unsigned int opcode, void* arg, unsigned int nr_args) {
+	return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+static int sysEnter(int ring_fd, unsigned int to_submit, unsigned int min_complete,
+                    unsigned int flags, const void* arg, size_t argsz) {
+	return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, argsz));
+}
+
+UringReactor::UringReactor()
+	: _ring_fd(-1), _features(0), _sq_ptr(NULL), _sq_size(0), _sq_head(NULL), _sq_tail(NULL),
+	  _sq_mask(NULL), _sq_array(NULL), _sqes(NULL), _sqes_size(0), _sq_entries(0), _sq_local_tail(0),
+	  _cq_ptr(NULL), _cq_size(0), _cq_head(NULL), _cq_tail(NULL), _cq_mask(NULL), _cqes(NULL),
+	  _buf_ring(NULL), _buf_ring_size(0), _buf_tail(0) {
+	_setup(URING_ENTRIES);
+	_setupBuffers();
+}
+
+UringReactor::~UringReactor() {
+	_teardown();
+	for (size_t fd = 0; fd < _send_slots.size(); ++fd)
+		delete _send_slots[fd];
+}
+
+// Multishot recv came last of what this backend uses, in 6.0
+static bool kernelAtLeast(int major, int minor) {
+	struct utsname name;
+	int have_major = 0;
+	int have_minor = 0;
+	if (uname(&name) != 0 || std::sscanf(name.release, "%d.%d", &have_major, &have_minor) != 2)
+		return false;
+	return have_major > major || (have_major == major && have_minor >= minor);
+}
+
+//
+/* Ring setup */
+//
+
+void UringReactor::_setup(unsigned int entries) {
+	struct io_uring_params params;
+	std::memset(&params, 0, sizeof(params));
+
+	_ring_fd = sysSetup(entries, &params);
+	if (_ring_fd < 0)
+		throw std::runtime_error(std::string("io_uring_setup failed: ") + std::strerror(errno));
+	_features = params.features;
+	if (!(_features & IORING_FEAT_EXT_ARG) || !kernelAtLeast(6, 0)) {
+		_teardown();
+		throw std::runtime_error("io_uring backend needs Linux 6.0 or later (multishot recv)");
+	}
+
+	_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+	_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (_features & IORING_FEAT_SINGLE_MMAP) {
+		if (_cq_size > _sq_size)
+			_sq_size = _cq_size;
+		_cq_size = _sq_size;
+	}
+
+	_sq_ptr = mmap(NULL, _sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	               _ring_fd, IORING_OFF_SQ_RING);
+	if (_sq_ptr == MAP_FAILED) {
+		_sq_ptr = NULL;
+		_teardown();
+		throw std::runtime_error("Failed to map io_uring submission ring");
+	}
+
+	if (_features & IORING_FEAT_SINGLE_MMAP) {
+		_cq_ptr = _sq_ptr;
+	} else {
+		_cq_ptr = mmap(NULL, _cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+		               _ring_fd, IORING_OFF_CQ_RING);
+		if (_cq_ptr == MAP_FAILED) {
+			_cq_ptr = NULL;
+			_teardown();
+			throw std::runtime_error("Failed to map io_uring completion ring");
+		}
+	}
+
+	_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	void* sqes = mmap(NULL, _sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+	                  _ring_fd, IORING_OFF_SQES);
+	if (sqes == MAP_FAILED) {
+		_teardown();
+		throw std::runtime_error("Failed to map io_uring submission entries");
+	}
+	_sqes = static_cast<struct io_uring_sqe*>(sqes);
+
+	char* sq = static_cast<char*>(_sq_ptr);
+	_sq_head = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+	_sq_tail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+	_sq_mask = reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+	_sq_array = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+	_sq_entries = params.sq_entries;
+	_sq_local_tail = *_sq_tail;
+
+	char* cq = static_cast<char*>(_cq_ptr);
+	_cq_head = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+	_cq_tail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+	_cq_mask = reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+	_cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+}
+
+void UringReactor::_setupBuffers() {
+	_buf_ring_size = URING_RECV_BUFFERS * sizeof(struct io_uring_buf);
+	void* ring = mmap(NULL, _buf_ring_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (ring == MAP_FAILED) {
+		_teardown();
+		throw std::runtime_error("Failed to map io_uring buffer ring");
+	}
+	_buf_ring = static_cast<struct io_uring_buf*>(ring);
+
+	struct io_uring_buf_reg reg;
+	std::memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(_buf_ring));
+	reg.ring_entries = URING_RECV_BUFFERS;
+	reg.bgid = URING_BUFFER_GROUP;
+	if (sysRegister(_ring_fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+		int error = errno;
+		_teardown();
+		throw std::runtime_error(std::string("Failed to register io_uring buffer ring: ") + std::strerror(error));
+	}
+
+	_buffers.resize(static_cast<size_t>(URING_RECV_BUFFERS) * URING_RECV_BUFFER_SIZE);
+	for (unsigned short id = 0; id < URING_RECV_BUFFERS; ++id)
+		_giveBuffer(id);
+	__atomic_store_n(&_buf_ring[0].resv, _buf_tail, __ATOMIC_RELEASE);
+}
+
+void UringReactor::_teardown() {
+	// The kernel frees a closed ring in the background, and until then the
+	// requests still armed on it hold their files: a listener with a
+	// multishot accept would keep its port bound after the process exits.
+	// Cancelling everything first waits for them to let go.
+	if (_ring_fd != -1 && _sq_ptr) {
+		struct io_uring_sync_cancel_reg cancel;
+		std::memset(&cancel, 0, sizeof(cancel));
+		cancel.flags = IORING_ASYNC_CANCEL_ANY;
+		cancel.fd = -1;
+		cancel.timeout.tv_sec = 1;
+		sysRegister(_ring_fd, IORING_REGISTER_SYNC_CANCEL, &cancel, 1);
+	}
+	if (_buf_ring)
+		munmap(_buf_ring, _buf_ring_size);
+	_buf_ring = NULL;
+	if (_sqes)
+		munmap(_sqes, _sqes_size);
+	if (_cq_ptr && _cq_ptr != _sq_ptr)
+		munmap(_cq_ptr, _cq_size);
+	if (_sq_ptr)
+		munmap(_sq_ptr, _sq_size);
+	if (_ring_fd != -1)
+		close(_ring_fd);
+	_sqes = NULL;
+	_cq_ptr = NULL;
+	_sq_ptr = NULL;
+	_ring_fd = -1;
+}
+
+//
+/* Receive buffers */
+//
+
+void UringReactor::_giveBuffer(unsigned short id) {
+	struct io_uring_buf& buffer = _buf_ring[_buf_tail & (URING_RECV_BUFFERS - 1)];
+	buffer.addr = static_cast<unsigned long long>(
+		reinterpret_cast<uintptr_t>(&_buffers[static_cast<size_t>(id) * URING_RECV_BUFFER_SIZE]));
+	buffer.len = URING_RECV_BUFFER_SIZE;
+	buffer.bid = id;
+	_buf_tail++;
+}
+
+// The data of the last batch has been consumed: its buffers can be reused
+void UringReactor::_returnBuffers() {
+	if (_lent.empty())
+		return;
+	for (size_t i = 0; i < _lent.size(); ++i)
+		_giveBuffer(_lent[i]);
+	_lent.clear();
+	__atomic_store_n(&_buf_ring[0].resv, _buf_tail, __ATOMIC_RELEASE);
+}
+
+//
+/* Submission */
+//
+
+// Low 32 bits: the fd; then the op; polls carry the fd's generation on top
+unsigned long long UringReactor::_userData(int fd, int op, unsigned int gen) {
+	return (static_cast<unsigned long long>(gen & 0xffffff) << 40)
+		| (static_cast<unsigned long long>(op) << 32) | static_cast<unsigned int>(fd);
+}
+
+unsigned int UringReactor::_pending() const {
+	return _sq_local_tail - __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+}
+
+struct io_uring_sqe* UringReactor::_getSqe() {
+	// Ring full: hand the queued batch to the kernel right away
+	if (_pending() >= _sq_entries && _enter(0, -1) < 0)
+		return NULL;
+	if (_pending() >= _sq_entries)
+		return NULL;
+
+	unsigned int index = _sq_local_tail & *_sq_mask;
+	struct io_uring_sqe* sqe = &_sqes[index];
+	std::memset(sqe, 0, sizeof(*sqe));
+	_sq_array[index] = index;
+	_sq_local_tail++;
+	return sqe;
+}
+
+// Submit everything queued; with min_complete > 0, also wait up to timeout_ms
+int UringReactor::_enter(unsigned int min_complete, int timeout_ms) {
+	__atomic_store_n(_sq_tail, _sq_local_tail, __ATOMIC_RELEASE);
+	unsigned int to_submit = _pending();
+
+	if (min_complete == 0)
+		return sysEnter(_ring_fd, to_submit, 0, 0, NULL, 0);
+
+	unsigned int flags = IORING_ENTER_GETEVENTS;
+	if (timeout_ms < 0)
+		return sysEnter(_ring_fd, to_submit, min_complete, flags, NULL, 0);
+
+	struct __kernel_timespec ts;
+	ts.tv_sec = timeout_ms / 1000;
+	ts.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+
+	struct io_uring_getevents_arg arg;
+	std::memset(&arg, 0, sizeof(arg));
+	arg.ts = static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(&ts));
+	flags |= IORING_ENTER_EXT_ARG;
+	return sysEnter(_ring_fd, to_submit, min_complete, flags, &arg, sizeof(arg));
+}
+
+void UringReactor::_queuePoll(int fd) {
+	FdState& state = _fds[fd];
+	struct io_uring_sqe* sqe = _getSqe();
+	if (!sqe) {
+		_rearm.push_back(fd); // Retry on the next wait()
+		return;
+	}
+
+	unsigned int mask = 0;
+	if (state.events & EVENT_READ)
+		mask |= POLLIN;
+	if (state.events & EVENT_WRITE)
+		mask |= POLLOUT;
+
+	sqe->opcode = IORING_OP_POLL_ADD;
+	sqe->fd = fd;
+	sqe->poll32_events = mask;
+	sqe->user_data = _userData(fd, OP_READY, state.gen);
+	state.armed = true;
+}
+
+void UringReactor::_queueCancel(int fd) {
+	FdState& state = _fds[fd];
+	struct io_uring_sqe* sqe = _getSqe();
+	if (sqe) {
+		sqe->opcode = IORING_OP_POLL_REMOVE;
+		sqe->fd = -1;
+		sqe->addr = _userData(fd, OP_READY, state.gen);
+		sqe->user_data = URING_IGNORE;
+	}
+	// Even if the cancel could not be queued, the generation bump below
+	// turns the in-flight completion into a stale one
+	state.armed = false;
+}
+
+//
+/* Reactor interface */
+//
+
+bool UringReactor::add(int fd, int events) {
+	if (fd < 0)
+		return false;
+	if (static_cast<size_t>(fd) >= _fds.size()) {
+		_fds.resize(fd + 1);
+		_ready_idx.resize(fd + 1, -1);
+	}
+	if (_fds[fd].registered)
+		return modify(fd, events);
+
+	FdState& state = _fds[fd];
+	state.registered = true;
+	state.events = events;
+	state.gen++;
+	if (events)
+		_queuePoll(fd);
+	return true;
+}
+
+bool UringReactor::modify(int fd, int events) {
+	if (fd < 0 || static_cast<size_t>(fd) >= _fds.size() || !_fds[fd].registered)
+		return false;
+
+	FdState& state = _fds[fd];
+	if (state.events == events)
+		return true;
+
+	if (state.armed)
+		_queueCancel(fd);
+	state.events = events;
+	state.gen++;
+	if (events)
+		_queuePoll(fd);
+	return true;
+}
+
+void UringReactor::remove(int fd) {
+	if (fd < 0 || static_cast<size_t>(fd) >= _fds.size() || !_fds[fd].registered)
+		return;
+
+	FdState& state = _fds[fd];
+	if (state.armed)
+		_queueCancel(fd);
+	state.registered = false;
+	state.events = 0;
+	state.gen++;
+}
+
+int UringReactor::wait(std::vector<ReactorEvent>& events, int timeout_ms) {
+	events.clear();
+	_returnBuffers();
+
+	// Re-arm the one-shot polls that fired last time (level-triggered)
+	std::vector<int> rearm;
+	rearm.swap(_rearm);
+	for (size_t i = 0; i < rearm.size(); ++i) {
+		FdState& state = _fds[rearm[i]];
+		if (state.registered && !state.armed && state.events)
+			_queuePoll(rearm[i]);
+	}
+
+	// One syscall: submit the batch and wait for at least one completion
+	if (_enter(1, timeout_ms) < 0) {
+		if (errno == ETIME)
+			return 0;
+		if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+			return -1;
+	}
+
+	unsigned int head = *_cq_head;
+	unsigned int tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+	for (; head != tail; ++head) {
+		const struct io_uring_cqe& cqe = _cqes[head & *_cq_mask];
+		if (cqe.user_data == URING_IGNORE)
+			continue;
+
+		int fd = static_cast<int>(cqe.user_data & 0xffffffffULL);
+		int op = static_cast<int>((cqe.user_data >> 32) & 0xff);
+		if (op == OP_READY) {
+			_pollEvent(cqe, fd, events);
+			continue;
+		}
+
+		ReactorEvent event;
+		event.fd = fd;
+		event.op = op;
+		event.result = cqe.res;
+		event.more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+		if (cqe.flags & IORING_CQE_F_BUFFER) {
+			unsigned short id = static_cast<unsigned short>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+			event.data = &_buffers[static_cast<size_t>(id) * URING_RECV_BUFFER_SIZE];
+			_lent.push_back(id);
+		}
+		events.push_back(event);
+	}
+	__atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+
+	for (size_t i = 0; i < events.size(); ++i) {
+		if (events[i].op == OP_READY)
+			_ready_idx[events[i].fd] = -1;
+	}
+	return static_cast<int>(events.size());
+}
+
+void UringReactor::_pollEvent(const struct io_uring_cqe& cqe, int fd, std::vector<ReactorEvent>& events) {
+	unsigned int gen = static_cast<unsigned int>(cqe.user_data >> 40);
+	if (static_cast<size_t>(fd) >= _fds.size() || !_fds[fd].registered || (_fds[fd].gen & 0xffffff) != gen)
+		return; // Completion of a cancelled or superseded request
+
+	_fds[fd].armed = false;
+	_rearm.push_back(fd);
+
+	int ready = 0;
+	if (cqe.res < 0) {
+		if (cqe.res == -ECANCELED)
+			return;
+		ready = EVENT_ERROR;
+	} else {
+		if (cqe.res & POLLIN)
+			ready |= EVENT_READ;
+		if (cqe.res & POLLOUT)
+			ready |= EVENT_WRITE;
+		if (cqe.res & (POLLERR | POLLHUP | POLLNVAL))
+			ready |= EVENT_ERROR;
+	}
+
+	// Merge repeated completions for the same fd
+	if (_ready_idx[fd] == -1) {
+		ReactorEvent event;
+		event.fd = fd;
+		event.events = ready;
+		_ready_idx[fd] = static_cast<int>(events.size());
+		events.push_back(event);
+	} else {
+		events[_ready_idx[fd]].events |= ready;
+	}
+}
+
+//
+/* Completion-based I/O */
+//
+
+bool UringReactor::acceptMultishot(int listen_fd) {
+	struct io_uring_sqe* sqe = _getSqe();
+	if (!sqe)
+		return false;
+	sqe->opcode = IORING_OP_ACCEPT;
+	sqe->fd = listen_fd;
+	sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+	sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+	sqe->user_data = _userData(listen_fd, OP_ACCEPT, 0);
+	return true;
+}
+
+bool UringReactor::recvMultishot(int fd) {
+	struct io_uring_sqe* sqe = _getSqe();
+	if (!sqe)
+		return false;
+	sqe->opcode = IORING_OP_RECV;
+	sqe->fd = fd;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = URING_BUFFER_GROUP;
+	sqe->user_data = _userData(fd, OP_RECV, 0);
+	return true;
+}
+
+bool UringReactor::send(int fd, const struct iovec* iov, int count, bool more) {
+	if (fd < 0)
+		return false;
+	if (static_cast<size_t>(fd) >= _send_slots.size())
+		_send_slots.resize(fd + 1, NULL);
+	if (!_send_slots[fd])
+		_send_slots[fd] = new SendSlot();
+
+	struct io_uring_sqe* sqe = _getSqe();
+	if (!sqe)
+		return false;
+	SendSlot& slot = *_send_slots[fd];
+	if (count > URING_IOV_MAX)
+		count = URING_IOV_MAX; // The rest goes with the next send
+	std::memcpy(slot.iov, iov, count * sizeof(struct iovec));
+	std::memset(&slot.message, 0, sizeof(slot.message));
+	slot.message.msg_iov = slot.iov;
+	slot.message.msg_iovlen = count;
+
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = fd;
+	sqe->addr = static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(&slot.message));
+	sqe->len = 1;
+	sqe->msg_flags = MSG_NOSIGNAL | (more ? MSG_MORE : 0);
+	sqe->user_data = _userData(fd, OP_SEND, 0);
+	return true;
+}
+
+bool UringReactor::readFile(int fd, int file_fd, off_t offset, char* buffer, size_t length) {
+	struct io_uring_sqe* sqe = _getSqe();
+	if (!sqe)
+		return false;
+	sqe->opcode = IORING_OP_READ;
+	sqe->fd = file_fd;
+	sqe->off = static_cast<unsigned long long>(offset);
+	sqe->addr = static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(buffer));
+	sqe->len = static_cast<unsigned int>(length);
+	sqe->user_data = _userData(fd, OP_READ, 0);
+	return true;
+}
+
+// The multishot recv ends with -ECANCELED (or whatever it was about to report)
+void UringReactor::cancelRecv(int fd) {
+	struct io_uring_sqe* sqe = _getSqe();
+	if (!sqe)
+		return;
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = -1;
+	sqe->addr = _userData(fd, OP_RECV, 0);
+	sqe->user_data = URING_IGNORE;
+}
+
+void UringReactor::cancel(int fd) {
+	struct io_uring_sqe* sqe = _getSqe();
+	if (!sqe)
+		return;
+	sqe->opcode = IORING_OP_ASYNC_CANCEL;
+	sqe->fd = fd;
+	sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+	sqe->user_data = URING_IGNORE;
+}
+
+#endif // WEBSERV_HAVE_IO_URING
@@ -0,0 +1,87 @@
+#include "VirtualHostTable.hpp"
+#include <cctype>
+
+#define VHOST_INITIAL_CAPACITY 16
+
+VirtualHostTable::VirtualHostTable() : _entries(VHOST_INITIAL_CAPACITY), _count(0) {}
+
+// FNV-1a over the lowercased name, seeded with the endpoint
+size_t VirtualHostTable::_hash(size_t endpoint, const char* name, size_t len) {
+	size_t hash = 2166136261u ^ endpoint;
+	for (size_t i = 0; i < len; ++i) {
+		hash ^= static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(name[i])));
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+bool VirtualHostTable::_equals(const std::string& stored, const char* name, size_t len) {
+	if (stored.length() != len)
+		return false;
+	for (size_t i = 0; i < len; ++i) {
+		if (stored[i] != std::tolower(static_cast<unsigned char>(name[i])))
+			return false;
+	}
+	return true;
+}
+
+void VirtualHostTable::insert(size_t endpoint, const std::string& name, size_t server) {
+	size_t existing;
+	if (name.empty() || find(endpoint, name.c_str(), name.length(), existing))
+		return;
+
+	// Keep the load factor under 1/2 so probe sequences stay short
+	if ((_count + 1) * 2 > _entries.size())
+		_grow();
+
+	Entry entry;
+	entry.name.reserve(name.length());
+	for (size_t i = 0; i < name.length(); ++i)
+		entry.name += static_cast<char>(std::tolower(static_cast<unsigned char>(name[i])));
+	entry.endpoint = endpoint;
+	entry.server = server;
+	entry.hash = _hash(endpoint, name.c_str(), name.length());
+	entry.used = true;
+
+	size_t mask = _entries.size() - 1;
+	size_t slot = entry.hash & mask;
+	while (_entries[slot].used)
+		slot = (slot + 1) & mask;
+	_entries[slot] = entry;
+	_count++;
+}
+
+bool VirtualHostTable::find(size_t endpoint, const char* name, size_t len, size_t& server) const {
+	size_t hash = _hash(endpoint, name, len);
+	size_t mask = _entries.size() - 1;
+
+	for (size_t slot = hash & mask; _entries[slot].used; slot = (slot + 1) & mask) {
+		const Entry& entry = _entries[slot];
+		if (entry.hash == hash && entry.endpoint == endpoint && _equals(entry.name, name, len)) {
+			server = entry.server;
+			return true;
+		}
+	}
+	return false;
+}
+
+void VirtualHostTable::clear() {
+	_entries.assign(VHOST_INITIAL_CAPACITY, Entry());
+	_count = 0;
+}
+
+void VirtualHostTable::_grow() {
+	std::vector<Entry> old;
+	old.swap(_entries);
+	_entries.resize(old.size() * 2);
+
+	size_t mask = _entries.size() - 1;
+	for (size_t i = 0; i < old.size(); ++i) {
+		if (!old[i].used)
+			continue;
+		size_t slot = old[i].hash & mask;
+		while (_entries[slot].used)
+			slot = (slot + 1) & mask;
+		_entries[slot] = old[i];
+	}
+}
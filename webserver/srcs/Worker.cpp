@@ -0,0 +1,1058 @@
+#include "Worker.hpp"
+#include "Client.hpp"
+#include "Config.hpp"
+#include "Reactor.hpp"
+#include "HttpRequest.hpp"
+#include "HttpResponse.hpp"
+#include "StaticFileHandler.hpp"
+#include "UploadHandler.hpp"
+#include "AllocCounter.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <stdexcept>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <ctime>
+
+Worker::Worker(const Config& config, int id, const std::vector<int>& listen_fds)
+	: _config(config), _id(id), _listen_fds(listen_fds), _reactor(NULL), _completion(false),
+	  _timers(_monotonicMs()), _now_ms(0), _date_second(0), _error_pages(config),
+	  _file_cache(config.getFileCacheSize(), config.getFileCacheMaxFile()) {
+	_updateClock();
+	try {
+		_reactor = Reactor::create(_config.getEventBackend());
+		_completion = _reactor->completesIo();
+		for (size_t i = 0; i < _listen_fds.size(); ++i) {
+			bool registered = _completion ? _reactor->acceptMultishot(_listen_fds[i])
+				: _reactor->add(_listen_fds[i], EVENT_READ);
+			if (!registered)
+				throw std::runtime_error("Failed to register server socket");
+		}
+		if (_file_cache.enabled() && !_reactor->add(_file_cache.getNotifyFd(), EVENT_READ))
+			throw std::runtime_error("Failed to register file cache notifications");
+	} catch (...) {
+		for (size_t i = 0; i < _listen_fds.size(); ++i)
+			close(_listen_fds[i]);
+		delete _reactor;
+		throw;
+	}
+}
+
+Worker::~Worker() {
+	// Close all client connections
+	for (size_t fd = 0; fd < _clients.size(); ++fd) {
+		if (_clients[fd]) {
+			delete _clients[fd];
+			close(fd);
+		}
+	}
+	for (size_t fd = 0; fd < _retiring.size(); ++fd) {
+		if (_retiring[fd]) {
+			delete _retiring[fd];
+			close(fd);
+		}
+	}
+
+	// Close server sockets
+	for (size_t i = 0; i < _listen_fds.size(); ++i)
+		close(_listen_fds[i]);
+
+	delete _reactor;
+}
+
+void Worker::run() {
+	std::cout << "Worker " << _id << " started (" << _reactor->name() << " backend)" << std::endl;
+
+	extern volatile sig_atomic_t g_shutdown;
+
+	std::vector<ReactorEvent> events;
+	while (!g_shutdown) {
+		// Sleep until the next timer is due
+		int ready = _reactor->wait(events, _timers.nextTimeout(_now_ms, MAX_WAIT_MS));
+
+		if (ready < 0) {
+			if (errno == EINTR) continue;
+			throw std::runtime_error("Event wait failed");
+		}
+
+		_updateClock();
+		_expireTimers();
+
+		for (size_t i = 0; i < events.size(); ++i) {
+			int current_fd = events[i].fd;
+			int revents = events[i].events;
+
+			if (events[i].op != OP_READY) {
+				_handleCompletion(events[i]);
+				continue;
+			}
+
+			if (current_fd == _file_cache.getNotifyFd()) {
+				_file_cache.processEvents();
+				continue;
+			}
+
+			int endpoint = _findListener(current_fd);
+			if (endpoint != -1) {
+				if (revents & EVENT_ERROR)
+					std::cerr << "Error on server socket" << std::endl;
+				else if (revents & EVENT_READ)
+					_acceptClients(endpoint);
+				continue;
+			}
+
+			// Client may have been removed earlier in this batch
+			if (!_getClient(current_fd))
+				continue;
+
+			// Check for errors
+			if (revents & EVENT_ERROR) {
+				_removeClient(current_fd);
+				continue;
+			}
+
+			// Handle incoming data
+			if (revents & EVENT_READ) {
+				_handleClientData(current_fd);
+				if (!_getClient(current_fd))
+					continue;
+			}
+
+			// Handle ready to write
+			if (revents & EVENT_WRITE)
+				_flushClientBuffer(current_fd);
+		}
+
+		_startOutput();
+	}
+}
+
+//
+/* Socket handling */
+//
+
+int Worker::_findListener(int fd) const {
+	for (size_t i = 0; i < _listen_fds.size(); ++i) {
+		if (_listen_fds[i] == fd)
+			return static_cast<int>(i);
+	}
+	return -1;
+}
+
+// Drain the accept queue until EAGAIN, at most accept_batch connections
+// per readiness event so one busy listener can't starve the others
+void Worker::_acceptClients(size_t endpoint) {
+	int listen_fd = _listen_fds[endpoint];
+	int batch = _config.getAcceptBatch();
+
+	for (int i = 0; i < batch; ++i) {
+		int client_fd = _acceptOne(listen_fd);
+		if (client_fd < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return; // Queue drained (or another worker won the race)
+			if (errno == EINTR)
+				continue;
+			_stats.accept_errors++;
+			if (errno == ECONNABORTED)
+				continue;
+			std::cerr << "Failed to accept client connection: " << std::strerror(errno) << std::endl;
+			return;
+		}
+		_stats.accepted++;
+		_addClient(client_fd, endpoint);
+	}
+
+	// Still backlogged after a full batch: record how deep the queue is
+	_stats.accept_batches_full++;
+	_sampleAcceptQueue(listen_fd);
+}
+
+int Worker::_acceptOne(int listen_fd) {
+#ifdef SOCK_NONBLOCK
+	// Non-blocking and close-on-exec in the same syscall
+	return accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+#else
+	int client_fd = accept(listen_fd, NULL, NULL);
+	if (client_fd >= 0)
+		_setNonBlocking(client_fd);
+	return client_fd;
+#endif
+}
+
+void Worker::_addClient(int client_fd, size_t endpoint) {
+	// Register with the event loop, or start receiving
+	bool registered = _completion ? _reactor->recvMultishot(client_fd) : _reactor->add(client_fd, EVENT_READ);
+	if (!registered) {
+		std::cerr << "Failed to register client: fd=" << client_fd << std::endl;
+		close(client_fd);
+		return;
+	}
+
+	// Create client instance
+	if (static_cast<size_t>(client_fd) >= _clients.size())
+		_clients.resize(client_fd + 1, NULL);
+	_clients[client_fd] = new Client(client_fd, endpoint);
+	_clients[client_fd]->setEvents(EVENT_READ);
+	_clients[client_fd]->setIo(_completion ? IO_RECV : 0);
+	_clients[client_fd]->setRequestStart(_now_ms);
+	_stats.active_connections++;
+	_updateTimer(_clients[client_fd]);
+}
+
+void Worker::_sampleAcceptQueue(int listen_fd) {
+#ifdef TCP_INFO
+	// On a listening socket tcpi_unacked is the current accept queue length
+	struct tcp_info info;
+	socklen_t len = sizeof(info);
+	if (getsockopt(listen_fd, IPPROTO_TCP, TCP_INFO, &info, &len) == 0 &&
+	    info.tcpi_unacked > _stats.accept_queue_peak)
+		_stats.accept_queue_peak = info.tcpi_unacked;
+#else
+	(void)listen_fd;
+#endif
+}
+
+void Worker::_handleClientData(int client_fd) {
+	char buffer[BUFFER_SIZE];
+	int bytes_read = recv(client_fd, buffer, sizeof(buffer), 0);
+
+	if (bytes_read < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+		return; // Stale readiness, nothing to read yet
+	_receive(client_fd, buffer, bytes_read);
+}
+
+// What a recv() returned: bytes, 0 at end of stream, negative on error
+void Worker::_receive(int client_fd, const char* data, int bytes_read) {
+	if (bytes_read <= 0) {
+		if (bytes_read == 0) {
+			std::cout << "Client disconnected: fd=" << client_fd << std::endl;
+		} else {
+			std::cerr << "Error reading from client: fd=" << client_fd << std::endl;
+		}
+		_removeClient(client_fd);
+		return;
+	}
+
+	Client* client = _getClient(client_fd);
+
+	// Already answered; whatever else arrives is dropped (see _closeIfDrained)
+	if (client->isLingering())
+		return;
+
+	// First bytes after an idle keep-alive: the header deadline starts now
+	if (client->getRequest().getBytesReceived() == 0)
+		client->setRequestStart(_now_ms);
+
+	// Parse chunk incrementally using your HttpRequest parser
+	client->getRequest().parse(data, bytes_read);
+
+	if (!_processRequests(client_fd))
+		return;
+
+	_updateTimer(client);
+}
+
+void Worker::_setNonBlocking(int fd) {
+	int flags = fcntl(fd, F_GETFL, 0);
+	if (flags == -1) {
+		flags = 0;
+	}
+	fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+//
+/* Request processing */
+//
+
+// A location's client_max_body_size overrides its server's
+static size_t bodyLimit(const ServerConfig& server, const LocationConfig* location) {
+	if (location && location->has_max_body_size)
+		return location->max_body_size;
+	return server.max_body_size;
+}
+
+static bool methodAllowed(const LocationConfig& location, const HttpRequest& request) {
+	std::string method = request.getMethodString();
+	for (size_t i = 0; i < location.methods.size(); ++i) {
+		if (location.methods[i] == method)
+			return true;
+	}
+	return false;
+}
+
+// If-None-Match lists this entity tag (weakly compared) or is "*"
+static bool notModified(const HttpRequest& request, const std::string& etag) {
+	const char* value;
+	size_t length;
+	if (etag.empty() || !request.findHeader(HEADER_IF_NONE_MATCH, value, length))
+		return false;
+	return HttpResponse::matchesEntityTag(value, length, etag);
+}
+
+// Answer every complete request already buffered, in order (pipelining).
+// Returns false if the client was closed and removed.
+bool Worker::_processRequests(int client_fd) {
+	Client* client = _getClient(client_fd);
+
+	while (!client->isClosing()) {
+		// Backpressure: a client that doesn't read its responses gets no new ones
+		if (client->getOutput().size() >= _config.getOutputHighWatermark()) {
+			if (!client->isPaused()) {
+				client->setPaused(true);
+				_stats.backpressure_pauses++;
+				_stats.paused_connections++;
+			}
+			break;
+		}
+
+		HttpRequest& request = client->getRequest();
+		if (request.needsBodyLimit()) {
+			// Headers are in: enforce the limit before any of the body is stored
+			const ServerConfig& server = _resolveServer(client, request);
+			const LocationConfig* location = _config.findLocation(request.getUri(), server);
+			request.setBodyLimit(bodyLimit(server, location), server.client_body_buffer_size);
+			client->markBodyRate(_now_ms, 0);
+			if (request.expectsContinue()) {
+				std::string interim("HTTP/1.1 100 Continue\r\n\r\n");
+				_sendToClient(client_fd, interim);
+			}
+		}
+		if (request.getState() == ERROR) {
+			// Can't find the next request boundary after a malformed one,
+			// and the rest of a rejected body may still be on its way
+			client->setLingering();
+			int code = request.getErrorCode() ? request.getErrorCode() : 400;
+			if (!_queueErrorPage(client_fd, _resolveServer(client, request), code, true)) {
+				HttpResponse response = HttpResponse::error(code);
+				_queueResponse(client_fd, response, true);
+			}
+			break;
+		}
+		if (!request.isComplete())
+			break;
+		_handleRequest(client_fd, request);
+		client->resetRequest();
+		client->setRequestStart(_now_ms);
+	}
+
+	if (_closeIfDrained(client))
+		return false;
+	_updateInterest(client);
+	return true;
+}
+
+void Worker::_handleRequest(int client_fd, HttpRequest& request) {
+	std::cout << "Request: " << request.getMethodString() << " " << request.getUri() << std::endl;
+
+	Client* client = _getClient(client_fd);
+	const ServerConfig& server_config = _resolveServer(client, request);
+	const LocationConfig* location = _config.findLocation(request.getUri(), server_config);
+
+	// Persistent unless the client opted out or used up keepalive_requests
+	size_t limit = static_cast<size_t>(_config.getKeepaliveRequests());
+	if (!request.keepAlive() || client->getRequestCount() + 1 >= limit)
+		client->setClosing();
+
+	// Response headers and other scratch come from the connection's arena,
+	// released in one go when the response has been queued
+	ArenaScope scope(client->getArena());
+	bool with_body = request.getMethod() != HEAD;
+
+	// Small static files are answered from the worker's cache when they can be
+	bool cacheable = _file_cache.enabled() && location && !location->stub_status
+		&& (request.getMethod() == GET || request.getMethod() == HEAD) && methodAllowed(*location, request);
+	if (cacheable) {
+		const CachedFile* cached = _file_cache.find(location->root, request.getUri());
+		if (cached && notModified(request, cached->etag)) {
+			HttpResponse response(304);
+			response.setHeader("ETag", cached->etag);
+			_queueResponse(client_fd, response, false);
+			return;
+		}
+		if (cached) {
+			_queuePrebuilt(client_fd, cached->head, with_body ? &cached->body : NULL);
+			return;
+		}
+	}
+
+	HttpResponse response = _buildResponse(request, server_config, location);
+	if (cacheable && response.getStatusCode() == 200)
+		_file_cache.insert(location->root, request.getUri(), STATIC_DEFAULT_FILE, response);
+	if (response.hasFileBody() && notModified(request, response.getHeader("ETag"))) {
+		HttpResponse not_modified(304);
+		not_modified.setHeader("ETag", response.getHeader("ETag"));
+		_queueResponse(client_fd, not_modified, false);
+		return;
+	}
+
+	if (!_queueErrorPage(client_fd, server_config, response.getStatusCode(), with_body))
+		_queueResponse(client_fd, response, with_body);
+}
+
+// Virtual host dispatch: endpoint the client connected to + Host header
+const ServerConfig& Worker::_resolveServer(const Client* client, const HttpRequest& request) const {
+	const char* host = "";
+	size_t host_length = 0;
+	request.findHeader(HEADER_HOST, host, host_length);
+	return _config.resolveServer(client->getEndpoint(), host, host_length);
+}
+
+HttpResponse Worker::_buildResponse(const HttpRequest& request, const ServerConfig& server_config,
+									const LocationConfig* location) {
+	if (!location) {
+		return HttpResponse::notFound("Location not configured");
+	}
+
+	if (!methodAllowed(*location, request)) {
+		return HttpResponse::methodNotAllowed("Method not allowed for this location");
+	}
+
+	if (location->stub_status) {
+		return _statusResponse();
+	}
+
+	HttpMethod method = request.getMethod();
+
+	// GET or DELETE -> Use StaticFileHandler
+	if (method == GET || method == DELETE) {
+		StaticFileHandler handler(location->root);
+		return handler.handleRequest(request);
+	}
+
+	// HEAD -> Same as GET; the body is dropped when the response is queued
+	else if (method == HEAD) {
+		StaticFileHandler handler(location->root);
+		return handler.handleRequest(request);
+	}
+
+	// POST -> Use UploadHandler
+	else if (method == POST) {
+		std::string upload_path = location->upload_path.empty() ? "./uploads" : location->upload_path;
+		UploadHandler uploader(upload_path, bodyLimit(server_config, location));
+		return uploader.handleUpload(request);
+	}
+
+	// PUT -> Create/Update resource (for testing, return success message)
+	else if (method == PUT) {
+		// PUT is for creating/updating resources
+		// For HTTP testing, return a success response
+		return HttpResponse::ok("<html><body><h1>201 Created</h1><p>Resource created/updated via PUT</p></body></html>", "text/html");
+	}
+
+	else {
+		return HttpResponse::badRequest("Method not implemented");
+	}
+}
+
+// System-wide TcpExt ListenOverflows from /proc/net/netstat, -1 if unavailable
+static long readListenOverflows() {
+	std::ifstream netstat("/proc/net/netstat");
+	std::string names;
+	std::string values;
+
+	while (std::getline(netstat, names) && std::getline(netstat, values)) {
+		if (names.compare(0, 7, "TcpExt:") != 0)
+			continue;
+		std::istringstream name_stream(names);
+		std::istringstream value_stream(values);
+		std::string name;
+		std::string value;
+		while (name_stream >> name && value_stream >> value) {
+			if (name == "ListenOverflows")
+				return std::atol(value.c_str());
+		}
+	}
+	return -1;
+}
+
+HttpResponse Worker::_statusResponse() const {
+	std::ostringstream body;
+	body << "Worker: " << _id << " (pid " << getpid() << ", " << _reactor->name() << ")\n"
+	     << "Active connections: " << _stats.active_connections << "\n"
+	     << "Accepted: " << _stats.accepted << "\n"
+	     << "Requests: " << _stats.requests << "\n"
+	     << "Accept errors: " << _stats.accept_errors << "\n"
+	     << "Accept batches full: " << _stats.accept_batches_full << "\n"
+	     << "Accept queue peak: " << _stats.accept_queue_peak << "\n"
+	     << "Output queued (bytes): " << _stats.output_queued << "\n"
+	     << "Output queue peak (bytes, one connection): " << _stats.output_queue_peak << "\n"
+	     << "Backpressure pauses: " << _stats.backpressure_pauses << "\n"
+	     << "Paused connections: " << _stats.paused_connections << "\n"
+	     << "Header deadline kills: " << _stats.header_deadline_kills << "\n"
+	     << "Slow body kills: " << _stats.slow_body_kills << "\n"
+	     << "Listen overflows (system): " << readListenOverflows() << "\n";
+	if (_file_cache.enabled()) {
+		unsigned long lookups = _file_cache.getHits() + _file_cache.getMisses();
+		body << "File cache: " << _file_cache.getCount() << " files, " << _file_cache.getBytes()
+		     << " of " << _file_cache.getCapacity() << " bytes\n"
+		     << "File cache hits: " << _file_cache.getHits() << ", misses: " << _file_cache.getMisses()
+		     << " (hit ratio " << (lookups ? _file_cache.getHits() * 100 / lookups : 0) << "%)\n"
+		     << "File cache evictions: " << _file_cache.getEvictions()
+		     << ", invalidations: " << _file_cache.getInvalidations() << "\n";
+	}
+	if (heapAllocations() >= 0)
+		body << "Heap allocations (process): " << heapAllocations() << "\n";
+	return HttpResponse::ok(body.str(), "text/plain");
+}
+
+//
+/* Output handling */
+//
+
+void Worker::_queueResponse(int client_fd, HttpResponse& response, bool with_body) {
+	Client* client = _getClient(client_fd);
+	_stats.requests++;
+	response.setHeader("Date", _date);
+	response.setHeader("Connection", client->isClosing() ? "close" : "keep-alive");
+
+	// Header block and body are queued as separate segments, body moved in
+	// or, for a file, left in the kernel
+	std::string head = response.buildHead();
+	_sendToClient(client_fd, head);
+	if (with_body && response.hasFileBody()) {
+		_sendToClient(client_fd, response.getFile(), response.getFileLength());
+	} else if (with_body) {
+		std::string body;
+		response.takeBody(body);
+		_sendToClient(client_fd, body);
+	}
+}
+
+// The server block's error_page for code, if it has one, queued from the
+// worker's prebuilt buffers
+bool Worker::_queueErrorPage(int client_fd, const ServerConfig& server, int code, bool with_body) {
+	if (code < 400)
+		return false;
+	const ErrorPage* page = _error_pages.find(&server - &_config.getServers()[0], code);
+	if (!page)
+		return false;
+	_queuePrebuilt(client_fd, page->head, with_body ? &page->body : NULL);
+	return true;
+}
+
+// A response kept ready in shared buffers (error pages, cached files);
+// only Date and Connection are formatted here
+void Worker::_queuePrebuilt(int client_fd, const SharedBuffer& head, const SharedBuffer* body) {
+	Client* client = _getClient(client_fd);
+	_stats.requests++;
+	std::string headers = "Date: " + _date + "\r\nConnection: "
+		+ (client->isClosing() ? "close" : "keep-alive") + "\r\n\r\n";
+	_sendToClient(client_fd, head);
+	_sendToClient(client_fd, headers);
+	if (body)
+		_sendToClient(client_fd, *body);
+}
+
+// Queues data without copying it; data is left empty
+void Worker::_sendToClient(int client_fd, std::string& data) {
+	if (data.empty())
+		return;
+	SharedBuffer buffer(data);
+	_sendToClient(client_fd, buffer);
+}
+
+// Queues a reference to a buffer that other responses may share
+void Worker::_sendToClient(int client_fd, const SharedBuffer& buffer) {
+	Client* client = _getClient(client_fd);
+	if (!client)
+		return;
+
+	OutputQueue& output = client->getOutput();
+	_stats.output_queued += buffer.size();
+	output.push(buffer, 0, buffer.size());
+	if (output.size() > _stats.output_queue_peak)
+		_stats.output_queue_peak = output.size();
+
+	_updateInterest(client);
+}
+
+// Queues a region of an open file, sent later with sendfile()
+void Worker::_sendToClient(int client_fd, const SharedFile& file, size_t length) {
+	Client* client = _getClient(client_fd);
+	if (!client)
+		return;
+
+	OutputQueue& output = client->getOutput();
+	_stats.output_queued += length;
+	output.push(file, 0, length);
+	if (output.size() > _stats.output_queue_peak)
+		_stats.output_queue_peak = output.size();
+
+	_updateInterest(client);
+}
+
+void Worker::_flushClientBuffer(int client_fd) {
+	Client* client = _getClient(client_fd);
+	if (!client)
+		return;
+
+	OutputQueue& output = client->getOutput();
+	if (!output.empty()) {
+		ssize_t sent = output.flush(client_fd);
+		if (sent > 0) {
+			_stats.output_queued -= sent;
+		} else if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+			return;
+		} else {
+			_removeClient(client_fd);
+			return;
+		}
+	}
+	_outputProgress(client);
+}
+
+// Some output went out: close, resume reading or wait for the rest
+void Worker::_outputProgress(Client* client) {
+	int client_fd = client->getFd();
+	OutputQueue& output = client->getOutput();
+	if (_closeIfDrained(client))
+		return;
+
+	// Drained below the low mark: read again and answer what was held back
+	if (client->isPaused() && output.size() <= _config.getOutputLowWatermark()) {
+		client->setPaused(false);
+		_stats.paused_connections--;
+		// Bytes not read while paused don't count against the body rate
+		client->markBodyRate(_now_ms, client->getRequest().getBodyReceived());
+		if (!_processRequests(client_fd))
+			return;
+	}
+
+	_updateInterest(client);
+	_updateTimer(client);
+}
+
+// Register exactly the events the client can make progress on
+void Worker::_updateInterest(Client* client) {
+	bool reading = client->isLingering() || (!client->isClosing() && !client->isPaused());
+	if (_completion) {
+		_updateOperations(client, reading);
+		return;
+	}
+
+	int events = 0;
+	if (reading)
+		events |= EVENT_READ;
+	if (!client->getOutput().empty())
+		events |= EVENT_WRITE;
+
+	if (events != client->getEvents()) {
+		_reactor->modify(client->getFd(), events);
+		client->setEvents(events);
+	}
+}
+
+// Once the last response of a closing connection is out, close it. A
+// lingering one only half-closes and keeps reading (and discarding) until
+// the peer closes too or LINGERING_TIMEOUT_MS passes; closing with unread
+// input would send a reset that can destroy the response in flight.
+// Returns true if the client was removed.
+bool Worker::_closeIfDrained(Client* client) {
+	if (!client->isClosing() || !client->getOutput().empty())
+		return false;
+	if (!client->isLingering()) {
+		_removeClient(client->getFd());
+		return true;
+	}
+	shutdown(client->getFd(), SHUT_WR);
+	_updateInterest(client);
+	_updateTimer(client);
+	return false;
+}
+
+//
+/* Completion-based I/O */
+//
+
+// What an event's operation leaves off the client's IO_* set
+static int finishedIo(const ReactorEvent& event) {
+	switch (event.op) {
+		case OP_RECV: return event.more ? 0 : IO_RECV | IO_CANCEL;
+		case OP_SEND: return IO_SEND;
+		case OP_READ: return IO_READ;
+		default: return 0;
+	}
+}
+
+void Worker::_handleCompletion(const ReactorEvent& event) {
+	if (event.op == OP_ACCEPT) {
+		_completeAccept(event);
+		return;
+	}
+
+	// A removed client is closed once nothing runs for it any more
+	if (static_cast<size_t>(event.fd) < _retiring.size() && _retiring[event.fd]) {
+		Client* client = _retiring[event.fd];
+		client->setIo(client->getIo() & ~finishedIo(event));
+		if (!(client->getIo() & IO_INFLIGHT)) {
+			delete client;
+			_retiring[event.fd] = NULL;
+			close(event.fd);
+		}
+		return;
+	}
+
+	Client* client = _getClient(event.fd);
+	if (!client)
+		return;
+	client->setIo(client->getIo() & ~finishedIo(event));
+	if (event.op == OP_RECV)
+		_completeRecv(client, event);
+	else if (event.op == OP_SEND)
+		_completeSend(client, event.result);
+	else if (event.op == OP_READ)
+		_completeRead(client, event.result);
+}
+
+void Worker::_completeAccept(const ReactorEvent& event) {
+	int endpoint = _findListener(event.fd);
+	if (endpoint == -1)
+		return;
+
+	if (event.result >= 0) {
+		_stats.accepted++;
+		_addClient(event.result, endpoint);
+	} else if (event.result != -ECANCELED) {
+		_stats.accept_errors++;
+		if (event.result != -ECONNABORTED)
+			std::cerr << "Failed to accept client connection: " << std::strerror(-event.result) << std::endl;
+	}
+
+	// The kernel ends a multishot accept on some errors
+	if (!event.more && !_reactor->acceptMultishot(event.fd))
+		std::cerr << "Failed to re-arm accept on server socket" << std::endl;
+}
+
+void Worker::_completeRecv(Client* client, const ReactorEvent& event) {
+	int client_fd = client->getFd();
+	bool reading = client->isLingering() || (!client->isClosing() && !client->isPaused());
+
+	if (event.result > 0) {
+		// Arrived before a cancel took effect: a paused client keeps it for
+		// later, one that is closing has no use for it
+		if (reading || !client->isClosing())
+			_receive(client_fd, event.data, event.result);
+	} else if (event.result != -ENOBUFS && event.result != -ECANCELED && reading) {
+		_receive(client_fd, NULL, event.result); // End of stream or error
+	}
+	// Otherwise out of receive buffers, cancelled, or not reading just now:
+	// re-armed below when it is wanted again, and an end of stream or error
+	// shows up again then
+
+	client = _getClient(client_fd);
+	if (client)
+		_updateInterest(client);
+}
+
+void Worker::_completeSend(Client* client, int result) {
+	if (result < 0) {
+		std::cerr << "Error sending to client: fd=" << client->getFd() << std::endl;
+		_removeClient(client->getFd());
+		return;
+	}
+	client->getOutput().consume(result);
+	_stats.output_queued -= result;
+	_outputProgress(client);
+}
+
+void Worker::_completeRead(Client* client, int result) {
+	if (result <= 0) {
+		// 0: the file was truncated since it was opened
+		std::cerr << "Error reading file for client: fd=" << client->getFd() << std::endl;
+		_removeClient(client->getFd());
+		return;
+	}
+	std::string& chunk = client->getChunk();
+	chunk.resize(result);
+	client->getOutput().fillFile(chunk);
+	_updateInterest(client);
+}
+
+// Keep a multishot recv armed exactly while the client is read from, and
+// list the client if it has output to start (or stop polling for a drained one)
+void Worker::_updateOperations(Client* client, bool reading) {
+	int client_fd = client->getFd();
+	int io = client->getIo();
+
+	if (reading && !(io & IO_RECV)) {
+		if (_reactor->recvMultishot(client_fd))
+			io |= IO_RECV;
+	} else if (!reading && (io & IO_RECV) && !(io & IO_CANCEL)) {
+		_reactor->cancelRecv(client_fd);
+		io |= IO_CANCEL;
+	}
+	if (!client->getOutput().empty() && !(io & IO_FLUSH)) {
+		_output_ready.push_back(client_fd);
+		io |= IO_FLUSH;
+	} else if (client->getOutput().empty() && (io & IO_POLL)) {
+		_reactor->remove(client_fd);
+		io &= ~IO_POLL;
+	}
+	client->setIo(io);
+}
+
+// Output is started once per loop iteration, after every event has been
+// handled, so whatever a client got queued leaves in one send
+void Worker::_startOutput() {
+	for (size_t i = 0; i < _output_ready.size(); ++i) {
+		Client* client = _getClient(_output_ready[i]);
+		if (!client || !(client->getIo() & IO_FLUSH))
+			continue;
+		client->setIo(client->getIo() & ~IO_FLUSH);
+		_submitOutput(client);
+	}
+	_output_ready.clear();
+}
+
+// One send of the memory segments at the front, and a read of the first
+// file region while the data before it is being sent. A large file region
+// is not copied through a buffer: once it reaches the front, the socket's
+// writability is polled and flush() sends it with sendfile(2).
+void Worker::_submitOutput(Client* client) {
+	int client_fd = client->getFd();
+	OutputQueue& output = client->getOutput();
+	int io = client->getIo();
+
+	size_t before;
+	const OutputSegment* file = output.firstFile(before);
+	bool large = file && (file->length > FILE_READ_MAX || (io & IO_POLL));
+	if (large && before == 0 && !(io & IO_SEND)) {
+		if (!(io & IO_POLL) && !_reactor->add(client_fd, EVENT_WRITE)) {
+			_removeClient(client_fd);
+			return;
+		}
+		client->setIo(io | IO_POLL);
+		return;
+	}
+	if (io & IO_POLL) {
+		_reactor->remove(client_fd);
+		io &= ~IO_POLL;
+	}
+
+	if (!(io & IO_SEND)) {
+		struct iovec iov[OUTPUT_IOV_MAX];
+		bool file_follows;
+		int count = output.gather(iov, OUTPUT_IOV_MAX, file_follows);
+		if (count > 0) {
+			if (!_reactor->send(client_fd, iov, count, file_follows)) {
+				client->setIo(io);
+				_removeClient(client_fd);
+				return;
+			}
+			io |= IO_SEND;
+		}
+	}
+
+	if (file && !large && !(io & IO_READ)) {
+		std::string& chunk = client->getChunk();
+		chunk.resize(file->length);
+		if (!_reactor->readFile(client_fd, file->file.fd(), file->offset, &chunk[0], file->length)) {
+			client->setIo(io);
+			_removeClient(client_fd);
+			return;
+		}
+		io |= IO_READ;
+	}
+	client->setIo(io);
+}
+
+//
+/* Client management */
+//
+
+Client* Worker::_getClient(int fd) const {
+	if (fd < 0 || static_cast<size_t>(fd) >= _clients.size())
+		return NULL;
+	return _clients[fd];
+}
+
+void Worker::_removeClient(int client_fd) {
+	Client* client = _getClient(client_fd);
+	if (!client)
+		return;
+
+	if (!_completion || (client->getIo() & IO_POLL))
+		_reactor->remove(client_fd);
+	_stats.output_queued -= client->getOutput().size();
+	if (client->isPaused())
+		_stats.paused_connections--;
+	_clients[client_fd] = NULL;
+	_stats.active_connections--;
+
+	// Operations still running may use its buffers and fd: both are kept
+	// until the last one has reported back
+	if (client->getIo() & IO_INFLIGHT) {
+		_reactor->cancel(client_fd);
+		_timers.cancel(client->getTimer());
+		if (static_cast<size_t>(client_fd) >= _retiring.size())
+			_retiring.resize(client_fd + 1, NULL);
+		_retiring[client_fd] = client;
+		return;
+	}
+
+	// Delete client (and its output queue)
+	delete client;
+	close(client_fd);
+}
+
+//
+/* Timeouts */
+//
+
+unsigned long Worker::_monotonicMs() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return static_cast<unsigned long>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Once per loop iteration. The Date header only changes when the
+// wall-clock second does, so it is formatted at most once a second.
+void Worker::_updateClock() {
+	_now_ms = _monotonicMs();
+	time_t now = time(NULL);
+	if (now == _date_second)
+		return;
+	_date_second = now;
+	_date = HttpResponse::httpDate(now);
+}
+
+// Re-arm the client's single timer for whatever it is waiting on now
+void Worker::_updateTimer(Client* client) {
+	const Timeouts& timeouts = _config.getTimeouts();
+	const HttpRequest& request = client->getRequest();
+	TimerNode& timer = client->getTimer();
+	unsigned long delay;
+
+	if (!client->getOutput().empty()) {
+		timer.kind = TIMEOUT_SEND;
+		delay = timeouts.send;
+	} else if (client->isLingering()) {
+		timer.kind = TIMEOUT_LINGER;
+		delay = LINGERING_TIMEOUT_MS;
+	} else if (request.getBytesReceived() == 0 && client->getRequestCount() > 0) {
+		timer.kind = TIMEOUT_KEEPALIVE;
+		delay = timeouts.keepalive;
+	} else if (request.getState() == BODY) {
+		timer.kind = TIMEOUT_BODY;
+		delay = timeouts.body;
+		// The end of the rate window, if it comes before the idle timeout
+		if (timeouts.body_min_rate > 0) {
+			unsigned long check = client->getRateMark() + timeouts.body_rate_window;
+			unsigned long until = check > _now_ms ? check - _now_ms : 0;
+			if (until < delay) {
+				timer.kind = TIMEOUT_BODY_RATE;
+				delay = until;
+			}
+		}
+	} else {
+		timer.kind = TIMEOUT_HEADER;
+		delay = timeouts.header;
+		// Trickling a byte at a time resets the idle timeout, but not this
+		if (timeouts.header_deadline > 0) {
+			unsigned long deadline = client->getRequestStart() + timeouts.header_deadline;
+			unsigned long until = deadline > _now_ms ? deadline - _now_ms : 0;
+			if (until < delay) {
+				timer.kind = TIMEOUT_HEADER_DEADLINE;
+				delay = until;
+			}
+		}
+	}
+	_timers.arm(timer, _now_ms, delay);
+}
+
+// At the end of a rate window: below client_body_min_rate, or start the next window
+bool Worker::_bodyRateTooLow(Client* client) const {
+	const Timeouts& timeouts = _config.getTimeouts();
+	size_t received = client->getRequest().getBodyReceived() - client->getRateMarkBytes();
+	unsigned long elapsed = _now_ms - client->getRateMark();
+	if (elapsed == 0)
+		elapsed = 1;
+	if (static_cast<double>(received) * 1000 / elapsed < timeouts.body_min_rate)
+		return true;
+	client->markBodyRate(_now_ms, client->getRequest().getBodyReceived());
+	return false;
+}
+
+void Worker::_expireTimers() {
+	static const char* reasons[] = {
+		"header", "body", "keep-alive", "send", "lingering", "header deadline", "body rate"
+	};
+
+	_expired.clear();
+	_timers.advance(_now_ms, _expired);
+
+	for (size_t i = 0; i < _expired.size(); ++i) {
+		TimerNode* timer = _expired[i];
+		if (timer->kind == TIMEOUT_BODY_RATE) {
+			Client* client = _getClient(timer->id);
+			if (!_bodyRateTooLow(client)) {
+				_updateTimer(client);
+				continue;
+			}
+			_stats.slow_body_kills++;
+		} else if (timer->kind == TIMEOUT_HEADER_DEADLINE) {
+			_stats.header_deadline_kills++;
+		}
+		std::cout << "Client timeout: fd=" << timer->id
+		          << " (" << reasons[timer->kind] << ")" << std::endl;
+		_removeClient(timer->id);
+	}
+}
+
+//
+/* Helper methods (kept for backward compatibility) */
+//
+
+std::string Worker::_readFile(const std::string& path) {
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file.is_open()) {
+		return "";
+	}
+
+	std::ostringstream contents;
+	contents << file.rdbuf();
+	return contents.str();
+}
+
+std::string Worker::_getContentType(const std::string& path) {
+	size_t dot_pos = path.find_last_of('.');
+	if (dot_pos == std::string::npos) {
+		return "application/octet-stream";
+	}
+
+	std::string ext = path.substr(dot_pos);
+	if (ext == ".html" || ext == ".htm") return "text/html";
+	if (ext == ".css") return "text/css";
+	if (ext == ".js") return "application/javascript";
+	if (ext == ".json") return "application/json";
+	if (ext == ".png") return "image/png";
+	if (ext == ".jpg" || ext == ".jpeg") return "image/jpeg";
+	if (ext == ".gif") return "image/gif";
+	if (ext == ".svg") return "image/svg+xml";
+	if (ext == ".txt") return "text/plain";
+	if (ext == ".pdf") return "application/pdf";
+
+	return "application/octet-stream";
+}
+
+bool Worker::_fileExists(const std::string& path) {
+	struct stat buffer;
+	return (stat(path.c_str(), &buffer) == 0 && S_ISREG(buffer.st_mode));
+}
+
+void Worker::_handleCgiRequest(int client_fd, const HttpRequest& request) {
+	// TODO: Implement CGI handling
+	(void)client_fd;
+	(void)request;
+}
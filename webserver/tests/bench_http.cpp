@@ -0,0 +1,146 @@
+// Closed-loop HTTP/1.1 keep-alive load generator
+// Usage: ./bench_http <port> <path> [connections] [seconds]
+// Each connection sends a GET, reads the whole response (Content-Length),
+// then sends the next one. Reports requests/s and payload throughput.
+// Build & run: make bench-http PORT=8080 URL_PATH=/index.html
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <poll.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+struct Conn {
+    int fd;
+    std::string request;
+    size_t sent;
+    std::string head;      // Response head being accumulated
+    long long body_left;   // -1 while reading the head
+};
+
+static double nowSec() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static int connectTo(int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <port> <path> [connections] [seconds]" << std::endl;
+        return 1;
+    }
+    int port = std::atoi(argv[1]);
+    std::string path = argv[2];
+    size_t nconns = argc > 3 ? std::atoi(argv[3]) : 16;
+    double seconds = argc > 4 ? std::atof(argv[4]) : 5;
+
+    std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    std::vector<Conn> conns(nconns);
+    std::vector<struct pollfd> pfds(nconns);
+    for (size_t i = 0; i < nconns; ++i) {
+        conns[i].fd = connectTo(port);
+        if (conns[i].fd < 0) {
+            std::cerr << "connect failed" << std::endl;
+            return 1;
+        }
+        conns[i].request = request;
+        conns[i].sent = 0;
+        conns[i].body_left = -1;
+    }
+
+    unsigned long requests = 0;
+    unsigned long long bytes = 0;
+    unsigned long errors = 0;
+    std::vector<char> buffer(256 * 1024);
+    double start = nowSec();
+    double end = start + seconds;
+
+    while (nowSec() < end) {
+        for (size_t i = 0; i < nconns; ++i) {
+            pfds[i].fd = conns[i].fd;
+            pfds[i].events = conns[i].sent < conns[i].request.size() ? POLLOUT : POLLIN;
+            pfds[i].revents = 0;
+        }
+        if (poll(&pfds[0], pfds.size(), 100) <= 0)
+            continue;
+
+        for (size_t i = 0; i < nconns; ++i) {
+            Conn& c = conns[i];
+            if (pfds[i].revents & POLLOUT) {
+                ssize_t n = send(c.fd, c.request.data() + c.sent, c.request.size() - c.sent, 0);
+                if (n > 0)
+                    c.sent += n;
+            } else if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                ssize_t n = recv(c.fd, &buffer[0], buffer.size(), 0);
+                if (n <= 0) {
+                    if (n < 0 && errno == EAGAIN)
+                        continue;
+                    // Server closed: reconnect and retry
+                    errors++;
+                    close(c.fd);
+                    c.fd = connectTo(port);
+                    c.sent = 0;
+                    c.head.clear();
+                    c.body_left = -1;
+                    if (c.fd < 0)
+                        return 1;
+                    continue;
+                }
+                size_t offset = 0;
+                if (c.body_left < 0) {
+                    c.head.append(&buffer[0], n);
+                    size_t head_end = c.head.find("\r\n\r\n");
+                    if (head_end == std::string::npos)
+                        continue;
+                    size_t cl = c.head.find("Content-Length: ");
+                    long long length = cl == std::string::npos ? 0 : std::atoll(c.head.c_str() + cl + 16);
+                    size_t extra = c.head.size() - (head_end + 4);
+                    offset = n - extra;
+                    c.body_left = length;
+                    c.head.clear();
+                }
+                long long take = static_cast<long long>(n - offset);
+                c.body_left -= take;
+                bytes += take;
+                if (c.body_left <= 0) {
+                    requests++;
+                    c.sent = 0;
+                    c.body_left = -1;
+                }
+            }
+        }
+    }
+
+    double elapsed = nowSec() - start;
+    std::cout << std::fixed << std::setprecision(0)
+              << path << ": " << requests / elapsed << " req/s, "
+              << std::setprecision(1) << bytes / elapsed / (1024 * 1024) << " MiB/s"
+              << " (" << nconns << " connections, " << errors << " reconnects)" << std::endl;
+    for (size_t i = 0; i < nconns; ++i)
+        close(conns[i].fd);
+    return 0;
+}
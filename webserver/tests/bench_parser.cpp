@@ -0,0 +1,140 @@
+// HTTP request parser benchmark
+// Parses a typical browser request over and over with one reused
+// HttpRequest (as a keep-alive connection does) and reports the cost and
+// the heap allocations per request. Allocations are counted by replacing
+// the global operator new.
+// Build & run: make bench-parser
+
+#include "HttpRequest.hpp"
+#include <iostream>
+#include <iomanip>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <sys/time.h>
+
+static unsigned long g_allocations = 0;
+
+void* operator new(size_t size) throw(std::bad_alloc) {
+    g_allocations++;
+    void* p = std::malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) throw() {
+    std::free(p);
+}
+
+static double nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static const char* g_request =
+    "GET /images/photos/2024/summer/beach.jpg?size=large&format=webp HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:120.0) Gecko/20100101 Firefox/120.0\r\n"
+    "Accept: image/avif,image/webp,*/*\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Referer: https://www.example.com/gallery/summer\r\n"
+    "Connection: keep-alive\r\n"
+    "Cookie: session=4f2a9c81d7e34b6a; theme=dark; lang=en\r\n"
+    "Sec-Fetch-Dest: image\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "\r\n";
+
+// One read carrying a pipelined mix: a GET, a POST with a
+// Content-Length body and a chunked POST
+static const char* g_pipeline =
+    "GET /api/items?page=2 HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "Accept: application/json\r\n"
+    "\r\n"
+    "POST /api/items HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 26\r\n"
+    "\r\n"
+    "{\"name\":\"lamp\",\"price\":42}"
+    "POST /api/upload HTTP/1.1\r\n"
+    "Host: www.example.com\r\n"
+    "Transfer-Encoding: chunked\r\n"
+    "\r\n"
+    "10\r\n0123456789abcdef\r\n"
+    "0\r\n\r\n";
+
+// Feed the request in pieces of `chunk` bytes (0 = all at once)
+static void bench(size_t chunk, size_t rounds) {
+    size_t len = std::strlen(g_request);
+    HttpRequest request;
+    bool ok = true;
+
+    // Warm up so buffers reach their steady-state capacity
+    request.parse(g_request, len);
+    request.reset();
+
+    unsigned long allocations = g_allocations;
+    double start = nowUs();
+    for (size_t r = 0; r < rounds; ++r) {
+        size_t step = chunk ? chunk : len;
+        for (size_t off = 0; off < len; off += step)
+            request.parse(g_request + off, off + step > len ? len - off : step);
+        ok = ok && request.isComplete() && request.keepAlive();
+        request.reset();
+    }
+    double elapsed = nowUs() - start;
+    allocations = g_allocations - allocations;
+
+    std::cout << std::setw(10) << (chunk ? chunk : len)
+              << std::setw(14) << std::fixed << std::setprecision(0) << elapsed * 1000.0 / rounds
+              << std::setw(14) << std::setprecision(2) << static_cast<double>(allocations) / rounds
+              << std::setw(14) << std::setprecision(0) << rounds / (elapsed / 1e6)
+              << (ok ? "" : "  PARSE FAILED") << std::endl;
+}
+
+// Parse the pipelined mix in one read, moving from request to request
+// with startNext() as a worker does
+static void benchPipeline(size_t rounds) {
+    size_t len = std::strlen(g_pipeline);
+    HttpRequest request;
+    size_t requests = 0;
+
+    request.parse(g_pipeline, len);
+    request.reset();
+
+    unsigned long allocations = g_allocations;
+    double start = nowUs();
+    for (size_t r = 0; r < rounds; ++r) {
+        request.parse(g_pipeline, len);
+        while (request.isComplete()) {
+            requests++;
+            request.startNext();
+        }
+        request.reset();
+    }
+    double elapsed = nowUs() - start;
+    allocations = g_allocations - allocations;
+
+    std::cout << std::setw(10) << "pipeline"
+              << std::setw(14) << std::fixed << std::setprecision(0) << elapsed * 1000.0 / requests
+              << std::setw(14) << std::setprecision(2) << static_cast<double>(allocations) / requests
+              << std::setw(14) << std::setprecision(0) << requests / (elapsed / 1e6)
+              << (requests == rounds * 3 ? "" : "  PARSE FAILED") << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t rounds = argc > 1 ? std::atoi(argv[1]) : 200000;
+
+    std::cout << std::setw(10) << "chunk" << std::setw(14) << "ns/request"
+              << std::setw(14) << "allocs/req" << std::setw(14) << "req/s" << std::endl;
+    bench(0, rounds);
+    bench(64, rounds);
+    bench(7, rounds / 4);
+    benchPipeline(rounds / 3);
+    return 0;
+}
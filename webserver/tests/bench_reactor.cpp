@@ -0,0 +1,99 @@
+// Event loop backend benchmark
+// Registers N idle socketpairs, then repeatedly makes one of them readable
+// and measures the cost of wait() + dispatch for that single event.
+// Build & run: make bench-reactor
+
+#include "Reactor.hpp"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#define BENCH_BUDGET_US 2000000.0
+
+static double nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static void raiseFdLimit() {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+    }
+}
+
+static double benchBackend(const std::string& backend, size_t connections, size_t rounds) {
+    Reactor* reactor = Reactor::create(backend);
+    std::vector<int> readers;
+    std::vector<int> writers;
+
+    for (size_t i = 0; i < connections; ++i) {
+        int pair[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) < 0)
+            break;
+        readers.push_back(pair[0]);
+        writers.push_back(pair[1]);
+        reactor->add(pair[0], EVENT_READ);
+    }
+
+    std::vector<ReactorEvent> events;
+    char byte = 'x';
+    double start = nowUs();
+    size_t r = 0;
+    for (; r < rounds; ++r) {
+        // Time budget per cell: poll gets slow with thousands of fds
+        if ((r & 255) == 0 && nowUs() - start > BENCH_BUDGET_US)
+            break;
+        size_t target = std::rand() % readers.size();
+        if (write(writers[target], &byte, 1) != 1)
+            break;
+        reactor->wait(events, 1000);
+        for (size_t i = 0; i < events.size(); ++i) {
+            if (read(events[i].fd, &byte, 1) != 1)
+                break;
+        }
+    }
+    double elapsed = nowUs() - start;
+
+    for (size_t i = 0; i < readers.size(); ++i) {
+        reactor->remove(readers[i]);
+        close(readers[i]);
+        close(writers[i]);
+    }
+    delete reactor;
+    return r ? elapsed * 1000.0 / r : 0; // ns per event
+}
+
+int main(int argc, char** argv) {
+    size_t rounds = argc > 1 ? std::atoi(argv[1]) : 20000;
+    const size_t sizes[] = { 10, 100, 1000, 5000, 9000 };
+    const char* backends[] = { "poll", "epoll", "io_uring" };
+
+    raiseFdLimit();
+    std::cout << "Per-event cost (ns) with N registered idle connections" << std::endl;
+    std::cout << std::setw(8) << "N";
+    for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); ++b)
+        std::cout << std::setw(12) << backends[b];
+    std::cout << std::endl;
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+        std::cout << std::setw(8) << sizes[s];
+        for (size_t b = 0; b < sizeof(backends) / sizeof(backends[0]); ++b) {
+            if (!Reactor::isSupported(backends[b])) {
+                std::cout << std::setw(12) << "n/a";
+                continue;
+            }
+            std::cout << std::setw(12) << std::fixed << std::setprecision(0)
+                      << benchBackend(backends[b], sizes[s], rounds);
+        }
+        std::cout << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,133 @@
+// HTTP response serialization benchmark
+// Builds typical 200, 304 and 404 replies the way a worker does (inside
+// an ArenaScope, Connection header added last) and serializes the head,
+// reporting the cost and heap allocations per response. The same replies
+// through a std::map and an ostringstream, as responses used to be
+// built, are timed alongside for comparison. The body is never part of
+// the head, so its size doesn't enter either figure. Allocations are
+// counted by AllocCounter (built with WEBSERV_COUNT_ALLOCS).
+// Build & run: make bench-response
+
+#include "HttpResponse.hpp"
+#include "AllocCounter.hpp"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <map>
+#include <string>
+#include <cstdlib>
+#include <sys/time.h>
+
+static double nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+enum Reply { REPLY_200, REPLY_304, REPLY_404 };
+
+static const char* g_names[] = { "200 file", "304", "404" };
+static const std::string g_page(2048, 'x');
+static const std::string g_error_page(3335, 'e');
+
+static std::string current(Reply reply, std::string& body) {
+    HttpResponse response;
+    switch (reply) {
+        case REPLY_200:
+            response.setContentType("application/javascript");
+            response.setBody(g_page);
+            response.setHeader("ETag", "\"65a1f3c2-800\"");
+            response.setHeader("Last-Modified", "Fri, 12 Jan 2024 18:03:14 GMT");
+            break;
+        case REPLY_304:
+            response.setStatusCode(304);
+            response.setHeader("ETag", "\"65a1f3c2-800\"");
+            break;
+        case REPLY_404:
+            response.setStatusCode(404);
+            response.setContentType("text/html");
+            response.setBody(g_error_page);
+            break;
+    }
+    response.setHeader("Connection", "keep-alive");
+    std::string head = response.buildHead();
+    response.takeBody(body);
+    return head;
+}
+
+static std::string previous(Reply reply, std::string& body) {
+    std::map<std::string, std::string> headers;
+    int code = 200;
+    std::string message = "OK";
+    headers["Server"] = "WebServ/1.0";
+    switch (reply) {
+        case REPLY_200:
+            headers["Content-Type"] = "application/javascript";
+            body = g_page;
+            headers["Content-Length"] = "2048";
+            headers["ETag"] = "\"65a1f3c2-800\"";
+            headers["Last-Modified"] = "Fri, 12 Jan 2024 18:03:14 GMT";
+            break;
+        case REPLY_304:
+            code = 304;
+            message = "Not Modified";
+            headers["ETag"] = "\"65a1f3c2-800\"";
+            break;
+        case REPLY_404:
+            code = 404;
+            message = "Not Found";
+            headers["Content-Type"] = "text/html";
+            body = g_error_page;
+            headers["Content-Length"] = "3335";
+            break;
+    }
+    headers["Connection"] = "keep-alive";
+
+    std::ostringstream out;
+    out << "HTTP/1.1 " << code << " " << message << "\r\n";
+    for (std::map<std::string, std::string>::const_iterator it = headers.begin(); it != headers.end(); ++it)
+        out << it->first << ": " << it->second << "\r\n";
+    out << "\r\n";
+    return out.str();
+}
+
+static void bench(const char* label, Reply reply, bool use_current, size_t rounds) {
+    Arena arena;
+    size_t bytes = 0;
+
+    long allocations = heapAllocations();
+    double start = nowUs();
+    for (size_t r = 0; r < rounds; ++r) {
+        std::string body;
+        if (use_current) {
+            ArenaScope scope(arena);
+            std::string head = current(reply, body);
+            bytes += head.size();
+        } else {
+            std::string head = previous(reply, body);
+            bytes += head.size();
+        }
+    }
+    double elapsed = nowUs() - start;
+    allocations = heapAllocations() - allocations;
+
+    std::cout << std::setw(10) << g_names[reply] << std::setw(10) << label
+              << std::setw(12) << bytes / rounds
+              << std::setw(14) << std::fixed << std::setprecision(0) << elapsed * 1000.0 / rounds
+              << std::setw(14) << std::setprecision(2) << static_cast<double>(allocations) / rounds
+              << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t rounds = argc > 1 ? std::atoi(argv[1]) : 500000;
+
+    // Counted allocations include copying the body into the response:
+    // one per reply that has a body, in both columns
+    std::cout << std::setw(10) << "reply" << std::setw(10) << "builder" << std::setw(12) << "head bytes"
+              << std::setw(14) << "ns/response" << std::setw(14) << "allocs/resp" << std::endl;
+    for (int reply = REPLY_200; reply <= REPLY_404; ++reply) {
+        bench("current", static_cast<Reply>(reply), true, rounds);
+        bench("previous", static_cast<Reply>(reply), false, rounds);
+    }
+    return 0;
+}
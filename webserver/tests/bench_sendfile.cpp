@@ -0,0 +1,156 @@
+// Static file delivery benchmark: read() into memory vs sendfile()
+// Sends one file over a loopback TCP connection through an OutputQueue,
+// either read whole into a string first (how files used to be served)
+// or queued as a file region and sent with sendfile(). Each run happens
+// in a forked child so its peak RSS can be reported on its own. A reader
+// thread in the child drains the socket.
+// Build & run: make bench-sendfile [FILE_MB=256]
+
+#include "OutputQueue.hpp"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+
+static double nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static void* drain(void* arg) {
+    int fd = *static_cast<int*>(arg);
+    static char buffer[1 << 16];
+    while (read(fd, buffer, sizeof(buffer)) > 0) {}
+    return NULL;
+}
+
+// Connected loopback pair: sender (non-blocking, like a worker's) and receiver
+static bool connectPair(int& sender, int& receiver) {
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(addr);
+    if (listener < 0 || bind(listener, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0
+        || listen(listener, 1) != 0
+        || getsockname(listener, reinterpret_cast<struct sockaddr*>(&addr), &length) != 0)
+        return false;
+    sender = socket(AF_INET, SOCK_STREAM, 0);
+    if (connect(sender, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+        return false;
+    receiver = accept(listener, NULL, NULL);
+    close(listener);
+    fcntl(sender, F_SETFL, fcntl(sender, F_GETFL) | O_NONBLOCK);
+    return receiver >= 0;
+}
+
+// Flush until empty, waiting for the socket like the event loop would
+static bool sendAll(OutputQueue& output, int fd) {
+    while (!output.empty()) {
+        if (output.flush(fd) < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                return false;
+            struct pollfd writable = { fd, POLLOUT, 0 };
+            poll(&writable, 1, -1);
+        }
+    }
+    return true;
+}
+
+// One response in the child: a small head, then the file either way
+static int serve(const char* path, bool use_sendfile) {
+    int sender, receiver;
+    if (!connectPair(sender, receiver))
+        return 1;
+    pthread_t reader;
+    pthread_create(&reader, NULL, drain, &receiver);
+
+    int file = open(path, O_RDONLY);
+    off_t size = lseek(file, 0, SEEK_END);
+    OutputQueue output;
+    std::string head = "HTTP/1.1 200 OK\r\nContent-Type: video/mp4\r\n\r\n";
+    output.push(head);
+
+    if (use_sendfile) {
+        output.push(SharedFile(file), 0, size);
+    } else {
+        std::string body;
+        body.resize(size);
+        size_t done = 0;
+        while (done < static_cast<size_t>(size)) {
+            ssize_t n = pread(file, &body[done], size - done, done);
+            if (n <= 0)
+                return 1;
+            done += n;
+        }
+        close(file);
+        output.push(body);
+    }
+
+    bool ok = sendAll(output, sender);
+    close(sender);
+    pthread_join(reader, NULL);
+    close(receiver);
+    return ok ? 0 : 1;
+}
+
+static void bench(const char* path, size_t size, bool use_sendfile) {
+    double start = nowUs();
+    pid_t child = fork();
+    if (child == 0)
+        _exit(serve(path, use_sendfile));
+
+    int status;
+    struct rusage usage;
+    wait4(child, &status, 0, &usage);
+    double elapsed = (nowUs() - start) / 1e6;
+    bool ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+
+    std::cout << std::setw(10) << (use_sendfile ? "sendfile" : "read")
+              << std::setw(12) << std::fixed << std::setprecision(0) << size / elapsed / 1e6
+              << std::setw(14) << usage.ru_maxrss / 1024
+              << std::setw(12) << std::setprecision(2)
+              << (usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+                  + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6)
+              << (ok ? "" : "  FAILED") << std::endl;
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? std::atoi(argv[1]) : 256;
+    size_t size = megabytes << 20;
+
+    char path[] = "/tmp/bench_sendfile_XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0)
+        return 1;
+    std::string block(1 << 20, 'v');
+    for (size_t i = 0; i < megabytes; ++i) {
+        if (write(fd, block.data(), block.size()) != static_cast<ssize_t>(block.size()))
+            return 1;
+    }
+    close(fd);
+
+    std::cout << megabytes << " MB file over loopback TCP" << std::endl;
+    std::cout << std::setw(10) << "path" << std::setw(12) << "MB/s"
+              << std::setw(14) << "peak RSS MB" << std::setw(12) << "CPU s" << std::endl;
+    for (int round = 0; round < 2; ++round) {
+        bench(path, size, false);
+        bench(path, size, true);
+    }
+    unlink(path);
+    return 0;
+}
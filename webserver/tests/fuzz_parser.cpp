@@ -0,0 +1,268 @@
+// HTTP request parser fuzzer and split-point stress test
+// The parser must reach the same result however the bytes are split
+// across reads. Every input is parsed in one piece to get a reference
+// transcript (each request's method, path, headers, body, or its error),
+// then again split at every byte boundary (the seed corpus) or in random
+// chunks, and the transcripts are compared. Mutated copies of the corpus
+// check the same on malformed input and give the sanitizers something to
+// find.
+//
+// Build & run: make fuzz (standalone driver, ASan + UBSan)
+//              make fuzz-libfuzzer (clang -fsanitize=fuzzer, corpus dir optional)
+// Standalone: ./fuzz_parser [iterations] [file...]; files join the seed corpus
+
+#include "HttpRequest.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <sys/time.h>
+
+#define FUZZ_BODY_LIMIT 65536 // setBodyLimit() as a worker would call it
+#define FUZZ_MAX_REQUESTS 16  // Pipelined requests recorded per input
+
+static const char* g_seeds[] = {
+    "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n",
+    "GET /index.html?a=1&b=%20 HTTP/1.1\r\nHost: example.com\r\nUser-Agent: fuzz\r\n"
+    "Accept: */*\r\nConnection: keep-alive\r\n\r\n",
+    "HEAD /a/./b/../c//d HTTP/1.0\r\nHost: x\r\n\r\n",
+    "POST /upload HTTP/1.1\r\nHost: x\r\nContent-Type: text/plain\r\n"
+    "Content-Length: 11\r\n\r\nhello world",
+    "POST /upload HTTP/1.1\r\nHost: x\r\nTransfer-Encoding: chunked\r\n\r\n"
+    "5;ext=1\r\nhello\r\n6\r\n world\r\n0\r\nTrailer: t\r\n\r\n",
+    "POST /upload HTTP/1.1\r\nHost: x\r\nExpect: 100-continue\r\n"
+    "Content-Type: multipart/form-data; boundary=\"b0undary\"\r\nContent-Length: 5\r\n\r\nabcde",
+    "GET /one HTTP/1.1\r\nHost: x\r\n\r\nGET /two HTTP/1.1\r\nHost: x\r\n\r\n"
+    "DELETE /three HTTP/1.1\r\nHost: x\r\nConnection: close\r\n\r\n",
+    "\r\n\r\nGET /after-blank-lines HTTP/1.1\nHost: bare-lf\n\n",
+    "PUT /p HTTP/1.1\r\nHost: x\r\nContent-Length: 3\r\n\r\nabcGET /q HTTP/1.1\r\nHost: y\r\n\r\n",
+    "GET http://example.com/absolute?q HTTP/1.1\r\nHost: example.com\r\n\r\n",
+    "GET / HTTP/1.1\r\nHost: a\r\nHost: b\r\n\r\n",
+    "GET / HTTP/1.1\r\nBad Header\r\n\r\n",
+    "POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\nContent-Length: 3\r\n\r\n",
+    "BREW /pot HTTP/1.1\r\n\r\n",
+    "GET / HTTP/2.0\r\n\r\n",
+};
+
+//
+/* Transcript */
+//
+
+static void describe(const HttpRequest& request, std::ostringstream& out) {
+    if (request.getState() == ERROR) {
+        out << "error " << request.getErrorCode() << "\n";
+        return;
+    }
+    out << request.getMethodString() << " " << request.getUri() << " ?" << request.getQueryString()
+        << " " << request.getHttpVersion() << " keep-alive=" << request.keepAlive()
+        << " headers=" << request.getHeaderCount() << "\n";
+    for (int id = 0; id < HEADER_COUNT; ++id) {
+        const char* value;
+        size_t length;
+        if (request.findHeader(static_cast<HeaderId>(id), value, length))
+            out << "  " << headerName(static_cast<HeaderId>(id)) << ": " << std::string(value, length) << "\n";
+    }
+    out << "  body " << request.getBody().size() << ": " << request.getBody().str() << "\n";
+}
+
+// Feed the pieces like a worker: set the body limit once the headers are
+// in, record and move past every completed request
+static std::string transcript(const uint8_t* data, size_t size, const std::vector<size_t>& cuts) {
+    HttpRequest request;
+    std::ostringstream out;
+    size_t recorded = 0;
+    size_t start = 0;
+
+    request.requireBodyLimit();
+    for (size_t piece = 0; piece <= cuts.size() && recorded < FUZZ_MAX_REQUESTS; ++piece) {
+        size_t end = piece < cuts.size() ? cuts[piece] : size;
+        request.parse(reinterpret_cast<const char*>(data) + start, end - start);
+        start = end;
+
+        while (recorded < FUZZ_MAX_REQUESTS) {
+            if (request.needsBodyLimit())
+                request.setBodyLimit(FUZZ_BODY_LIMIT);
+            if (request.getState() == ERROR) {
+                describe(request, out);
+                return out.str(); // A worker closes the connection here
+            }
+            if (!request.isComplete())
+                break;
+            describe(request, out);
+            recorded++;
+            request.startNext();
+        }
+    }
+    out << "pending state " << request.getState() << "\n";
+    return out.str();
+}
+
+static void failure(const uint8_t* data, size_t size, const std::vector<size_t>& cuts,
+                    const std::string& expected, const std::string& actual) {
+    std::cerr << "Split changed the result. Input (" << size << " bytes):\n"
+              << std::string(reinterpret_cast<const char*>(data), size) << "\nCuts:";
+    for (size_t i = 0; i < cuts.size(); ++i)
+        std::cerr << " " << cuts[i];
+    std::cerr << "\n--- whole ---\n" << expected << "--- split ---\n" << actual;
+    std::abort();
+}
+
+// Reference transcript against `rounds` random chunkings (seeded by seed)
+static void checkRandomSplits(const uint8_t* data, size_t size, unsigned int seed, int rounds) {
+    std::vector<size_t> none;
+    std::string expected = transcript(data, size, none);
+
+    for (int round = 0; round < rounds; ++round) {
+        std::vector<size_t> cuts;
+        size_t max_piece = 1 + (seed % 64);
+        for (size_t at = 0; ; ) {
+            seed = seed * 1103515245 + 12345;
+            at += 1 + (seed >> 16) % max_piece;
+            if (at >= size)
+                break;
+            cuts.push_back(at);
+        }
+        std::string actual = transcript(data, size, cuts);
+        if (actual != expected)
+            failure(data, size, cuts, expected, actual);
+    }
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    if (size == 0)
+        return 0;
+    // First byte picks the chunking, the rest is the input
+    checkRandomSplits(data + 1, size - 1, data[0], 2);
+    return 0;
+}
+
+#ifndef FUZZ_LIBFUZZER
+
+//
+/* Standalone driver */
+//
+
+static unsigned int g_seed = 0x5eed;
+
+static unsigned int nextRandom() {
+    g_seed = g_seed * 1103515245 + 12345;
+    return g_seed >> 8;
+}
+
+// Byte flips, inserts, deletes and splices of HTTP syntax
+static std::string mutate(const std::string& input) {
+    static const char* tokens[] = {
+        "\r\n", "\n", ":", " ", "%", "%2e", "..", "/", "?", ";", "0\r\n\r\n", "\r\n\r\n",
+        "Content-Length: ", "Transfer-Encoding: chunked\r\n", "Expect: 100-continue\r\n",
+        "ffffffffffffffff", "99999999999999999999", "\t", "\0"
+    };
+    std::string out = input;
+    int edits = 1 + nextRandom() % 4;
+
+    for (int i = 0; i < edits; ++i) {
+        size_t at = out.empty() ? 0 : nextRandom() % out.size();
+        switch (nextRandom() % 4) {
+            case 0:
+                if (!out.empty())
+                    out[at] = static_cast<char>(nextRandom());
+                break;
+            case 1:
+                if (!out.empty())
+                    out.erase(at, 1 + nextRandom() % 8);
+                break;
+            case 2: {
+                const char* token = tokens[nextRandom() % (sizeof(tokens) / sizeof(tokens[0]))];
+                out.insert(at, token, *token ? std::strlen(token) : 1);
+                break;
+            }
+            default:
+                out.insert(at, out.substr(nextRandom() % (out.size() + 1), nextRandom() % 32));
+                break;
+        }
+    }
+    return out;
+}
+
+static double nowUs() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return tv.tv_sec * 1e6 + tv.tv_usec;
+}
+
+static const uint8_t* bytes(const std::string& s) {
+    return reinterpret_cast<const uint8_t*>(s.data());
+}
+
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? std::atol(argv[1]) : 20000;
+    std::vector<std::string> corpus;
+    for (size_t i = 0; i < sizeof(g_seeds) / sizeof(g_seeds[0]); ++i)
+        corpus.push_back(g_seeds[i]);
+    for (int i = 2; i < argc; ++i) {
+        std::ifstream file(argv[i], std::ios::binary);
+        std::ostringstream contents;
+        contents << file.rdbuf();
+        corpus.push_back(contents.str());
+    }
+
+    // 1. Every seed split in two at every byte, and in single bytes
+    size_t splits = 0;
+    for (size_t i = 0; i < corpus.size(); ++i) {
+        const std::string& input = corpus[i];
+        std::vector<size_t> cuts;
+        std::string expected = transcript(bytes(input), input.size(), cuts);
+        for (size_t at = 1; at < input.size(); ++at) {
+            cuts.assign(1, at);
+            std::string actual = transcript(bytes(input), input.size(), cuts);
+            if (actual != expected)
+                failure(bytes(input), input.size(), cuts, expected, actual);
+            splits++;
+        }
+        cuts.clear();
+        for (size_t at = 1; at < input.size(); ++at)
+            cuts.push_back(at);
+        std::string actual = transcript(bytes(input), input.size(), cuts);
+        if (actual != expected)
+            failure(bytes(input), input.size(), cuts, expected, actual);
+    }
+    std::cout << "Split points: " << corpus.size() << " seeds, " << splits << " splits OK" << std::endl;
+
+    // 2. Mutated seeds under random chunkings
+    for (long i = 0; i < iterations; ++i) {
+        std::string input = mutate(corpus[nextRandom() % corpus.size()]);
+        checkRandomSplits(bytes(input), input.size(), nextRandom(), 4);
+    }
+    std::cout << "Mutations: " << iterations << " inputs x 4 chunkings OK" << std::endl;
+
+    // 3. Throughput over the seed corpus, each parsed whole
+    size_t rounds = 20000;
+    size_t requests = 0;
+    size_t total_bytes = 0;
+    double start = nowUs();
+    for (size_t round = 0; round < rounds; ++round) {
+        const std::string& input = corpus[round % corpus.size()];
+        HttpRequest request;
+        request.requireBodyLimit();
+        request.parse(input.data(), input.size());
+        while (request.getState() != ERROR) {
+            if (request.needsBodyLimit())
+                request.setBodyLimit(FUZZ_BODY_LIMIT);
+            if (!request.isComplete())
+                break;
+            requests++;
+            request.startNext();
+        }
+        total_bytes += input.size();
+    }
+    double elapsed = (nowUs() - start) / 1e6;
+    std::cout << "Throughput: " << static_cast<long>(requests / elapsed) << " requests/s, "
+              << static_cast<long>(total_bytes / elapsed / 1e6) << " MB/s over the seeds"
+              << " (sanitized build; make bench-parser for optimized numbers)" << std::endl;
+    return 0;
+}
+
+#endif // FUZZ_LIBFUZZER
@@ -46,7 +46,7 @@ void testHttpRequestParser() {
     std::cout << "  Method: " << req2.getMethodString() << std::endl;
     std::cout << "  URI: " << req2.getUri() << std::endl;
     std::cout << "  Content-Length: " << req2.getContentLength() << std::endl;
-    std::cout << "  Body: " << req2.getBody() << std::endl;
+    std::cout << "  Body: " << req2.getBody().str() << std::endl;
     std::cout << "  Complete: " << (req2.isComplete() ? "Yes" : "No") << std::endl;
     std::cout << std::endl;
     
@@ -64,6 +64,113 @@ void testHttpRequestParser() {
     std::cout << "  URI: " << req3.getUri() << std::endl;
     std::cout << "  Complete: " << (req3.isComplete() ? "Yes" : "No") << std::endl;
     std::cout << std::endl;
+    
+    // Test pipelined requests arriving in one read
+    const char* pipelined = 
+        "GET /first HTTP/1.1\r\n"
+        "Host: localhost:8080\r\n"
+        "\r\n"
+        "GET /second HTTP/1.0\r\n"
+        "\r\n";
+    
+    HttpRequest req4;
+    req4.parse(pipelined, strlen(pipelined));
+    
+    std::cout << "Pipelined Requests:" << std::endl;
+    std::cout << "  First: " << req4.getUri() << " keep-alive " << (req4.keepAlive() ? "Yes" : "No") << std::endl;
+    req4.startNext();
+    std::cout << "  Second: " << req4.getUri() << " keep-alive " << (req4.keepAlive() ? "Yes" : "No") << std::endl;
+    std::cout << "  Complete: " << (req4.isComplete() ? "Yes" : "No") << std::endl;
+    std::cout << std::endl;
+    
+    // Test chunked body delivered one byte at a time, with a trailer
+    const char* chunked_request = 
+        "POST /upload HTTP/1.1\r\n"
+        "Host: localhost:8080\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "5;name=value\r\nHello\r\n"
+        "7\r\n, World\r\n"
+        "0\r\n"
+        "Checksum: abc\r\n"
+        "\r\n";
+    
+    HttpRequest req5;
+    for (size_t i = 0; i < strlen(chunked_request); ++i)
+        req5.parse(chunked_request + i, 1);
+    
+    std::cout << "Chunked Request:" << std::endl;
+    std::cout << "  Body: " << req5.getBody().str() << std::endl;
+    std::cout << "  Complete: " << (req5.isComplete() ? "Yes" : "No") << std::endl;
+    
+    HttpRequest req6;
+    req6.requireBodyLimit();
+    req6.parse(chunked_request, strlen(chunked_request));
+    req6.setBodyLimit(8);
+    std::cout << "  Over an 8 byte limit: " << req6.getErrorCode() << std::endl;
+    
+    HttpRequest req7;
+    req7.requireBodyLimit();
+    req7.parse(chunked_request, strlen(chunked_request));
+    req7.setBodyLimit(1024, 4);
+    std::cout << "  Spooled past a 4 byte buffer: " << (req7.getBody().isSpooled() ? "Yes" : "No")
+              << " (" << req7.getBody().str() << ")" << std::endl;
+    
+    // Transfer-Encoding must be exactly one coding, chunked; otherwise 501
+    const char* codings[] = {
+        "Transfer-Encoding: CHUNKED\r\n", "Transfer-Encoding: chunked ,\r\n",
+        "Transfer-Encoding: gzip, chunked\r\n", "Transfer-Encoding: chunked, chunked\r\n",
+        "Transfer-Encoding: xchunked\r\n", "Transfer-Encoding: gzip\r\nTransfer-Encoding: chunked\r\n"
+    };
+    for (size_t i = 0; i < sizeof(codings) / sizeof(codings[0]); ++i) {
+        std::string coded = std::string("POST /upload HTTP/1.1\r\nHost: localhost\r\n")
+            + codings[i] + "\r\n0\r\n\r\n";
+        HttpRequest req;
+        req.parse(coded.c_str(), coded.length());
+        std::string line(codings[i], strlen(codings[i]) - 2);
+        for (size_t crlf; (crlf = line.find("\r\n")) != std::string::npos; )
+            line.replace(crlf, 2, " / ");
+        std::cout << "  " << line << " -> "
+                  << (req.isComplete() ? 200 : req.getErrorCode()) << std::endl;
+    }
+    std::cout << std::endl;
+    
+    // Test known-header ids: every name must hash back to itself
+    size_t mismatches = 0;
+    for (int id = 0; id < HEADER_COUNT; ++id) {
+        const char* name = headerName(static_cast<HeaderId>(id));
+        if (lookupHeaderId(name, strlen(name)) != id)
+            mismatches++;
+    }
+    std::cout << "Header Ids:" << std::endl;
+    std::cout << "  Round-trip mismatches: " << mismatches << std::endl;
+    std::cout << "  \"cOnTeNt-LeNgTh\" known: "
+              << (lookupHeaderId("cOnTeNt-LeNgTh", 14) == HEADER_CONTENT_LENGTH ? "Yes" : "No") << std::endl;
+    std::cout << "  \"X-Custom\" known: "
+              << (lookupHeaderId("X-Custom", 8) != HEADER_UNKNOWN ? "Yes" : "No") << std::endl;
+    
+    HttpRequest req8;
+    const char* duplicate_host = "GET / HTTP/1.1\r\nHost: a\r\nHost: b\r\n\r\n";
+    req8.parse(duplicate_host, strlen(duplicate_host));
+    std::cout << "  Duplicate Host: " << req8.getErrorCode() << std::endl;
+    std::cout << std::endl;
+    
+    // Test path decoding and normalization
+    const char* targets[] = {
+        "/a/./b//c", "/a/b/../c/", "/%2e%2e/etc/passwd", "/a..b.txt", "/sp%20ace", "/x/%2E%2E/%2e%2e/y"
+    };
+    std::cout << "Path Normalization:" << std::endl;
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); ++i) {
+        std::string line = std::string("GET ") + targets[i] + " HTTP/1.1\r\nHost: a\r\n\r\n";
+        HttpRequest req;
+        req.parse(line.c_str(), line.length());
+        std::cout << "  " << targets[i] << " -> ";
+        if (req.getState() == ERROR)
+            std::cout << req.getErrorCode() << std::endl;
+        else
+            std::cout << req.getUri() << std::endl;
+    }
+    std::cout << std::endl;
 }
 
 void testHttpResponse() {
@@ -74,11 +181,41 @@ void testHttpResponse() {
     std::cout << "OK Response:" << std::endl;
     std::cout << resp1.build() << std::endl;
     
+    // Test arena-backed headers, as the worker builds responses
+    Arena arena;
+    for (int round = 0; round < 2; ++round) {
+        ArenaScope scope(arena);
+        HttpResponse resp = HttpResponse::ok("arena", "text/plain");
+        resp.setHeader("X-Round", round ? "second" : "first");
+        std::cout << "Arena response " << round << ": " << resp.buildHead().size()
+                  << " header bytes, " << arena.getUsed() << " arena bytes" << std::endl;
+    }
+    std::cout << "  Arena after reset: " << arena.getUsed() << " bytes" << std::endl << std::endl;
+    
     // Test 404 response
     HttpResponse resp2 = HttpResponse::notFound();
     std::cout << "404 Response:" << std::endl;
     std::cout << resp2.build() << std::endl;
     
+    // Headers keep the order they were first set; unknown codes still get a status line
+    HttpResponse resp4 = HttpResponse::error(418);
+    resp4.setHeader("content-type", "text/plain");
+    std::cout << "Unlisted status, header replaced in place:" << std::endl;
+    std::cout << resp4.buildHead() << std::endl;
+    
+    // If-None-Match: whole tags only, W/ ignored, commas inside quotes kept
+    std::string etag = HttpResponse::entityTag(0x65a1f3c2, 0x800);
+    const char* conditions[] = {
+        "*", "\"65a1f3c2-800\"", "W/\"65a1f3c2-800\"", "\"x\", W/\"65a1f3c2-800\"",
+        "\"65a1f3c2-8000\"", "\"5a1f3c2-800\"", "\"a,\"65a1f3c2-800\"\"", "\"x\", *", "65a1f3c2-800"
+    };
+    std::cout << "If-None-Match against " << etag << ":" << std::endl;
+    for (size_t i = 0; i < sizeof(conditions) / sizeof(conditions[0]); ++i) {
+        bool match = HttpResponse::matchesEntityTag(conditions[i], strlen(conditions[i]), etag);
+        std::cout << "  " << conditions[i] << " -> " << (match ? "304" : "200") << std::endl;
+    }
+    std::cout << std::endl;
+    
     // Test redirect
     HttpResponse resp3 = HttpResponse::redirect("/new-location");
     std::cout << "Redirect Response:" << std::endl;